@@ -0,0 +1,217 @@
+/**
+ * DDS sound effects for the piano tiles game
+ *
+ * The synthesis ISR is the one that used to live in main(), moved here
+ * so that it can be started on either core. The per-sample math is in
+ * synth.c; this file owns the DAC, the timer and the command FIFO. With AUDIO_ON_CORE1 the
+ * game loop on core 0 never takes the 40 kHz interrupt. Sound requests
+ * are pushed into the SIO FIFO and picked up by a protothread on
+ * core 1 (see protothread_audio_cmd in mandelbrot_fixvfloat.c).
+ *
+ */
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/spi.h"
+#include "hardware/sync.h"
+#include "hardware/structs/systick.h"
+#include "audio.h"
+
+// SPI data
+uint16_t DAC_data_1 ; // output value
+uint16_t DAC_data_0 ; // output value
+
+// DAC parameters (see the DAC datasheet)
+// A-channel, 1x, active
+#define DAC_config_chan_A 0b0011000000000000
+// B-channel, 1x, active
+#define DAC_config_chan_B 0b1011000000000000
+
+//SPI configurations (note these represent GPIO number, NOT pin number)
+#define PIN_MISO 4
+#define PIN_CS   5
+#define PIN_SCK  6
+#define PIN_MOSI 7
+#define LDAC     8
+#define LED      25
+#define ISR      15
+#define SPI_PORT spi0
+
+// ISR cost is measured with the SysTick counter of the audio core
+#define SYSTICK_MASK        0x00FFFFFF
+#define CYCLES_PER_US       125
+#define CYCLES_PER_SAMPLE   (CYCLES_PER_US*AUDIO_PERIOD_US)
+
+volatile audio_stats_t audio_stats ;
+volatile uint32_t audio_notes_started ;
+volatile uint32_t audio_note_start_us ;
+volatile uint32_t audio_song_clock ;
+static uint32_t stats_start_us ;
+
+// The ISR owns the load counters. audio_print_stats() asks for them by
+// bumping stats_requested; the ISR copies them out, clears them and
+// answers with stats_served, all between two samples, so no update is
+// lost whichever core the reader runs on.
+#define STATS_WAIT_US       (4*AUDIO_PERIOD_US)
+static volatile uint32_t stats_requested, stats_served ;
+static audio_stats_t stats_taken ;
+static synth_stats_t synth_taken ;
+
+// the repeating timer and (on core 1) the alarm pool that drives it
+static struct repeating_timer timer_audio ;
+#if AUDIO_ON_CORE1
+static alarm_pool_t *audio_alarm_pool ;
+#endif
+
+// This timer ISR is called on whichever core ran audio_timer_start()
+static bool repeating_timer_callback_audio(struct repeating_timer *t) {
+    uint32_t start = systick_hw->cvr ;
+    gpio_put(ISR, 1) ;
+
+    // Mask with DAC control bits
+    DAC_data_0 = (DAC_config_chan_B | (synth_sample() & 0xffff))  ;
+
+    // SPI write (no spinlock b/c of SPI buffer)
+    spi_write16_blocking(SPI_PORT, &DAC_data_0, 1) ;
+
+    // the sample just written was the first of a new melody note
+    uint32_t notes = synth_notes_started() ;
+    if (notes != audio_notes_started) {
+        audio_note_start_us = time_us_32() ;
+        __dmb() ;
+        audio_notes_started = notes ;
+    }
+    audio_song_clock = synth_song_samples() | (synth_song_playing() ? AUDIO_SONG_PLAYING : 0) ;
+
+    gpio_put(ISR, 0) ;
+
+    // SysTick counts down, 24 bits wide
+    uint32_t cycles = (start - systick_hw->cvr) & SYSTICK_MASK ;
+    audio_stats.calls++ ;
+    audio_stats.busy_cycles += cycles ;
+    if (cycles > audio_stats.max_cycles) audio_stats.max_cycles = cycles ;
+    if (stats_requested != stats_served) {
+        stats_taken = audio_stats ;
+        synth_taken = synth_stats ;
+        audio_stats.calls = 0 ;
+        audio_stats.busy_cycles = 0 ;
+        audio_stats.max_cycles = 0 ;
+        synth_stats.voice_cycles = 0 ;
+        synth_stats.voice_samples = 0 ;
+        __dmb() ;
+        stats_served = stats_requested ;
+    }
+
+    return true;
+}
+
+void audio_init() {
+ // Initialize SPI channel (channel, baud rate set to 20MHz)
+    spi_init(SPI_PORT, 20000000) ;
+    // Format (channel, data bits per transfer, polarity, phase, order)
+    spi_set_format(SPI_PORT, 16, 0, 0, 0);
+
+    // Map SPI signals to GPIO ports
+    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_CS, GPIO_FUNC_SPI) ;
+
+    // Map LDAC pin to GPIO port, hold it low (could alternatively tie to GND)
+    gpio_init(LDAC) ;
+    gpio_set_dir(LDAC, GPIO_OUT) ;
+    gpio_put(LDAC, 0) ;
+
+    // Map LED to GPIO port, make it low
+    gpio_init(LED) ;
+    gpio_set_dir(LED, GPIO_OUT) ;
+    gpio_put(LED, 0) ;
+
+
+    gpio_init(ISR) ;
+    gpio_set_dir(ISR, GPIO_OUT) ;
+    gpio_put(ISR, 0) ;
+
+    // sine table, note increments, wavetable voices
+    synth_init() ;
+}
+
+void audio_timer_start() {
+    // free-running SysTick on this core for ISR cycle counts
+    systick_hw->rvr = SYSTICK_MASK ;
+    systick_hw->csr = 0x5 ;
+    audio_stats.core = get_core_num() ;
+    stats_start_us = time_us_32() ;
+
+    // Negative delay so means we will call the callback, and call it
+    // again 25us (40kHz) later regardless of how long the callback took to execute
+#if AUDIO_ON_CORE1
+    // The default alarm pool fires on core 0, so core 1 gets its own
+    // pool (hardware alarm 2) whose IRQ is enabled on core 1
+    audio_alarm_pool = alarm_pool_create(2, 4) ;
+    alarm_pool_add_repeating_timer_us(audio_alarm_pool, -AUDIO_PERIOD_US,
+        repeating_timer_callback_audio, NULL, &timer_audio);
+#else
+    add_repeating_timer_us(-AUDIO_PERIOD_US, 
+        repeating_timer_callback_audio, NULL, &timer_audio);
+#endif
+}
+
+static void audio_send(uint32_t word) {
+#if AUDIO_ON_CORE1
+    // Never block the game loop: the FIFO is 8 deep, and a sound that
+    // does not fit would be stale by the time it played anyway
+    if (multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(word) ;
+    }
+#else
+    audio_command(word) ;
+#endif
+}
+
+void audio_play(uint sound) {
+    audio_send(AUDIO_CMD(sound)) ;
+}
+
+void audio_set_instrument(uint voice, uint instrument) {
+    audio_send(AUDIO_CMD_ARGS(SOUND_INSTRUMENT, voice, instrument)) ;
+}
+
+void audio_command(uint32_t word) {
+    synth_command(word) ;
+}
+
+void audio_print_stats() {
+    // the ISR hands the counters over at its next sample; if it is not
+    // running there is nothing to report
+    uint32_t wait_start = time_us_32() ;
+    stats_requested++ ;
+    while (stats_served != stats_requested) {
+        if (time_us_32() - wait_start > STATS_WAIT_US) return ;
+    }
+    __dmb() ;
+    uint32_t calls = stats_taken.calls ;
+    uint64_t busy = stats_taken.busy_cycles ;
+    uint32_t max = stats_taken.max_cycles ;
+    uint64_t voice_cycles = synth_taken.voice_cycles ;
+    uint32_t voice_samples = synth_taken.voice_samples ;
+    uint32_t elapsed_us = time_us_32() - stats_start_us ;
+    stats_start_us = time_us_32() ;
+    if (calls == 0 || elapsed_us == 0) return ;
+
+    // load in tenths of a percent of the audio core
+    uint32_t load = (uint32_t)((busy * 1000) / ((uint64_t)elapsed_us * CYCLES_PER_US)) ;
+    printf("audio core %d: %lu calls, avg %lu cyc, max %lu cyc, load %lu.%lu%%\n",
+        audio_stats.core, (unsigned long)calls, (unsigned long)(busy / calls),
+        (unsigned long)max, (unsigned long)(load / 10), (unsigned long)(load % 10)) ;
+    // wavetable voices, including the cost of skipping idle ones
+    if (voice_samples) {
+        printf("wavetable voices: %lu samples, %lu cyc/sample\n",
+            (unsigned long)voice_samples, (unsigned long)(voice_cycles / voice_samples)) ;
+    }
+    // everything the ISR spends on core 1 used to come out of core 0
+    if (audio_stats.core == 1) {
+        printf("core 0 ISR time freed: %lu us/s\n",
+            (unsigned long)((busy * 1000000) / ((uint64_t)elapsed_us * CYCLES_PER_US))) ;
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ * DDS sound effects for the piano tiles game
+ *
+ * The 40 kHz ISR and the DAC/timer/FIFO plumbing around it live here.
+ * The samples themselves come from synth.c, which mixes the sound
+ * effect state machine with two note voices, melody and accompaniment,
+ * driven by the song sequencer. The game only ever calls audio_play()
+ * with one of the sound codes in synth.h.
+ * Whether the ISR runs on core 0 or on core 1 is chosen at build time
+ * with AUDIO_ON_CORE1.
+ *
+ * HARDWARE CONNECTIONS
+ *  - GPIO 5 ---> DAC CS
+ *  - GPIO 6 ---> DAC SCK
+ *  - GPIO 7 ---> DAC MOSI
+ *  - GPIO 8 ---> DAC LDAC
+ *  - GPIO 15 --> ISR timing (high while the ISR is synthesizing)
+ *
+ */
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "pico/stdlib.h"
+#include "synth.h"
+
+// 1 - audio ISR runs on core 1, sound commands cross over the SIO FIFO
+// 0 - audio ISR runs on core 0 next to the game loop (original layout)
+#ifndef AUDIO_ON_CORE1
+#define AUDIO_ON_CORE1 1
+#endif
+
+// The ISR period that produces the Fs sample rate (synth.h)
+#define AUDIO_PERIOD_US 25
+
+// ISR load counters, in cycles of the core running the ISR
+typedef struct {
+    uint32_t calls ;        // ISR invocations since last reset
+    uint64_t busy_cycles ;  // total cycles spent inside the ISR
+    uint32_t max_cycles ;   // longest single ISR
+    uint     core ;         // core the ISR executes on
+} audio_stats_t ;
+
+extern volatile audio_stats_t audio_stats ;
+
+// Melody notes started, and when the first sample of the latest one
+// went to the DAC (time_us_32()); the time is written before the count
+extern volatile uint32_t audio_notes_started ;
+extern volatile uint32_t audio_note_start_us ;
+
+// Song position, written by the ISR after every sample: the song
+// samples sent to the DAC (synth_song_samples()), with AUDIO_SONG_PLAYING
+// set while the song plays. One word, so a reader on the other core
+// always sees both from the same sample.
+#define AUDIO_SONG_PLAYING          0x80000000u
+#define AUDIO_SONG_SAMPLES(clock)   ((clock) & ~AUDIO_SONG_PLAYING)
+extern volatile uint32_t audio_song_clock ;
+
+// Set up the SPI DAC, the ISR debug pin and the synthesizer
+void audio_init(void) ;
+// Start the 40 kHz timer on the calling core
+void audio_timer_start(void) ;
+// Request a sound effect (callable from the game loop on core 0)
+void audio_play(uint sound) ;
+// Pick the wavetable instrument a note voice plays (wavetables.h)
+void audio_set_instrument(uint voice, uint instrument) ;
+// Hand a command word popped from the FIFO to the engine (audio core)
+void audio_command(uint32_t word) ;
+// Print ISR load and reset the counters
+void audio_print_stats(void) ;
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Beatmaps: the charts the tiles are spawned from
+ *
+ * Streaming reader with lookahead (see beatmap.h for the format)
+ *
+ */
+#include "beatmap.h"
+
+static uint32_t read_varint(const uint8_t *map, uint32_t *pos) {
+    uint32_t v = 0 ;
+    uint shift = 0 ;
+    uint8_t byte ;
+    do {
+        byte = map[(*pos)++] ;
+        v |= (uint32_t)(byte & 0x7F) << shift ;
+        shift += 7 ;
+    } while ((byte & 0x80) && shift < 32) ;
+    return v ;
+}
+
+// Decode one record into the lookahead; false once nothing is left
+static bool decode(beatmap_reader_t *r) {
+    while (!r->ended) {
+        uint32_t start = r->pos ;
+        uint32_t v = read_varint(r->map, &r->pos) ;
+        uint8_t lanes = r->map[r->pos++] ;
+        r->tick += v >> 1 ;
+        if (lanes == 0) {
+            // the end record; an empty chart never loops
+            if (!r->loop || start == BEATMAP_HEADER) r->ended = true ;
+            r->pos = BEATMAP_HEADER ;
+            continue ;
+        }
+        beatmap_note_t *note = &r->ahead[(r->head + r->count) & (BEATMAP_LOOKAHEAD - 1)] ;
+        note->tick = r->tick ;
+        note->lanes = lanes ;
+        note->hold = (v & 1) ? read_varint(r->map, &r->pos) : 0 ;
+        r->count++ ;
+        return true ;
+    }
+    return false ;
+}
+
+bool beatmap_valid(const uint8_t *map) {
+    return map[0] == 'B' && map[1] == 'M' && map[2] == BEATMAP_VERSION &&
+           map[3] >= 1 && map[3] <= 8 && map[4] != 0 && beatmap_bpm(map) != 0 ;
+}
+
+void beatmap_reader_init(beatmap_reader_t *r, const uint8_t *map, bool loop) {
+    r->map = map ;
+    r->pos = BEATMAP_HEADER ;
+    r->tick = 0 ;
+    r->loop = loop ;
+    r->ended = !beatmap_valid(map) ;
+    r->head = r->count = 0 ;
+    while (r->count < BEATMAP_LOOKAHEAD && decode(r)) ;
+}
+
+const beatmap_note_t *beatmap_peek(const beatmap_reader_t *r, uint n) {
+    if (n >= r->count) return NULL ;
+    return &r->ahead[(r->head + n) & (BEATMAP_LOOKAHEAD - 1)] ;
+}
+
+bool beatmap_next(beatmap_reader_t *r, beatmap_note_t *note) {
+    if (r->count == 0) return false ;
+    *note = r->ahead[r->head] ;
+    r->head = (r->head + 1) & (BEATMAP_LOOKAHEAD - 1) ;
+    r->count-- ;
+    decode(r) ;
+    return true ;
+}
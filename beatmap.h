@@ -0,0 +1,74 @@
+/**
+ * Beatmaps: the charts the tiles are spawned from
+ *
+ * A beatmap is a const byte array, so it stays in flash and is read
+ * sequentially through XIP, never copied to SRAM. It is compiled from
+ * a text chart or a MIDI file by tools/beatmap_compile.py.
+ *
+ * Header, 8 bytes:
+ *
+ *   byte 0-1 - 'B' 'M'
+ *   byte 2   - format version (BEATMAP_VERSION)
+ *   byte 3   - lanes the chart is written for, 1..8
+ *   byte 4   - ticks per beat
+ *   byte 5   - reserved, 0
+ *   byte 6-7 - tempo in beats per minute, little endian
+ *
+ * followed by one record per note, in time order:
+ *
+ *   varint  - ticks since the previous note << 1 | has hold
+ *   byte    - lane mask, bit n for lane n; 0 ends the chart
+ *   varint  - hold length in ticks, only if has hold
+ *
+ * Varints are LEB128, low 7 bits first. A note with no hold on the
+ * next beat is two bytes. The end record's tick delta is the rest
+ * after the last note, so a looping chart keeps the beat.
+ *
+ * The reader keeps a position and a few notes of lookahead, so a chart
+ * of any length costs the same few bytes of SRAM.
+ *
+ */
+#ifndef BEATMAP_H
+#define BEATMAP_H
+
+#include "pico/stdlib.h"
+
+#define BEATMAP_VERSION     1
+#define BEATMAP_HEADER      8
+#define BEATMAP_LOOKAHEAD   4       // notes decoded ahead, power of two
+
+typedef struct {
+    uint32_t tick ;     // since the start of the chart
+    uint16_t hold ;     // ticks, 0 for a tap
+    uint8_t lanes ;
+} beatmap_note_t ;
+
+typedef struct {
+    const uint8_t *map ;
+    uint32_t pos ;          // byte offset of the next record
+    uint32_t tick ;         // tick of the last decoded record
+    bool loop ;
+    bool ended ;            // end record reached and not looping
+    beatmap_note_t ahead[BEATMAP_LOOKAHEAD] ;
+    uint8_t head ;
+    uint8_t count ;
+} beatmap_reader_t ;
+
+// Built-in charts (generated from charts/*.chart at build time)
+extern const uint8_t beatmap_ode_to_joy[] ;
+
+// True if map starts with a beatmap header this reader understands
+bool beatmap_valid(const uint8_t *map) ;
+static inline uint beatmap_lanes(const uint8_t *map) { return map[3] ; }
+static inline uint beatmap_ticks_per_beat(const uint8_t *map) { return map[4] ; }
+static inline uint beatmap_bpm(const uint8_t *map) { return map[6] | map[7] << 8 ; }
+
+// Start reading a chart from its first note; a looping reader starts
+// over after the end record, with the ticks still counting up
+void beatmap_reader_init(beatmap_reader_t *r, const uint8_t *map, bool loop) ;
+// The n-th upcoming note (n < BEATMAP_LOOKAHEAD), NULL past the end
+const beatmap_note_t *beatmap_peek(const beatmap_reader_t *r, uint n) ;
+// Take the next note; false at the end of a chart that does not loop
+bool beatmap_next(beatmap_reader_t *r, beatmap_note_t *note) ;
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * Timed visual effects for the piano tiles game
+ *
+ * Effects are functions of the time since they started, not of the
+ * number of frames drawn, so they look the same at any frame rate.
+ *
+ */
+#include "vga_graphics.h"
+#include "effects.h"
+
+#define NO_PIXEL            -1
+#define DITHER_LEVELS       16
+#define BURST_GRAVITY       int2fix15(600)      // pixels per second squared
+#define BURST_SPEED_MIN     60                  // pixels per second
+#define BURST_SPEED_RANGE   180
+
+// 4x4 ordered dither: the level at which each pixel is cleared
+static const uint8_t bayer[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5},
+} ;
+
+static uint random_below(effects_t *fx, uint n) {
+    fx->seed = fx->seed * 1664525u + 1013904223u ;
+    return (fx->seed >> 16) % n ;
+}
+
+static effect_t *effect_alloc(effects_t *fx, uint8_t kind, uint32_t now_us) {
+    for (uint i = 0; i < EFFECTS_MAX; i++) {
+        if (fx->pool[i].kind == EFFECT_FREE) {
+            fx->pool[i].kind = kind ;
+            fx->pool[i].start_us = now_us ;
+            return &fx->pool[i] ;
+        }
+    }
+    fx->dropped++ ;
+    return NULL ;
+}
+
+// Clear the pixels of one dither level of a flash
+static void dither_level(const effect_t *e, uint level) {
+    for (short y = e->y; y < e->y + e->h; y++) {
+        for (uint bx = 0; bx < 4; bx++) {
+            if (bayer[y & 3][bx] != level) continue ;
+            for (short x = e->x + ((bx - e->x) & 3); x < e->x + e->w; x += 4) drawPixel(x, y, 0) ;
+        }
+    }
+}
+
+static void erase_particles(effects_t *fx, effect_t *e) {
+    for (uint i = 0; i < EFFECT_PARTICLES; i++) {
+        if (e->drawn_x[i] != NO_PIXEL) fx->background(fx->ctx, e->drawn_x[i], e->drawn_y[i], 1, 1) ;
+        e->drawn_x[i] = NO_PIXEL ;
+    }
+}
+
+static void effect_end(effects_t *fx, effect_t *e) {
+    if (e->kind == EFFECT_FLASH) fx->background(fx->ctx, e->x, e->y, e->w, e->h) ;
+    else erase_particles(fx, e) ;
+    e->kind = EFFECT_FREE ;
+}
+
+static void flash_update(effect_t *e, uint32_t elapsed) {
+    if (elapsed < e->hold_us) return ;
+    uint target = (uint64_t)(elapsed - e->hold_us) * DITHER_LEVELS / (e->dur_us - e->hold_us) ;
+    while (e->level < target && e->level < DITHER_LEVELS) dither_level(e, e->level++) ;
+}
+
+static void burst_update(effects_t *fx, effect_t *e, uint32_t elapsed) {
+    fix15 t = (fix15)(((uint64_t)elapsed << 15) / 1000000) ;
+    fix15 fall = multfix15(multfix15(BURST_GRAVITY, t), t) >> 1 ;
+    erase_particles(fx, e) ;
+    for (uint i = 0; i < EFFECT_PARTICLES; i++) {
+        short x = e->x + fix2int15(multfix15(e->vx[i], t)) ;
+        short y = e->y + fix2int15((multfix15(e->vy[i], t) + fall)) ;
+        if (x < fx->min_x || x >= fx->max_x || y < fx->min_y || y >= fx->max_y) continue ;
+        drawPixel(x, y, e->color) ;
+        e->drawn_x[i] = x ;
+        e->drawn_y[i] = y ;
+    }
+}
+
+void effects_init(effects_t *fx, effects_background_t bg, void *ctx,
+                  short x0, short y0, short x1, short y1) {
+    fx->background = bg ;
+    fx->ctx = ctx ;
+    fx->min_x = x0 ; fx->min_y = y0 ; fx->max_x = x1 ; fx->max_y = y1 ;
+    if (!fx->seed) fx->seed = 1 ;
+    fx->dropped = 0 ;
+    for (uint i = 0; i < EFFECTS_MAX; i++) fx->pool[i].kind = EFFECT_FREE ;
+}
+
+bool effect_flash(effects_t *fx, short x, short y, short w, short h, char color,
+                  uint32_t hold_us, uint32_t fade_us, uint32_t now_us) {
+    effect_t *e = effect_alloc(fx, EFFECT_FLASH, now_us) ;
+    if (!e) return false ;
+    e->x = x ; e->y = y ; e->w = w ; e->h = h ;
+    e->color = color ;
+    e->hold_us = hold_us ;
+    e->dur_us = hold_us + fade_us ;
+    e->level = 0 ;
+    fillRect(x, y, w, h, color) ;
+    return true ;
+}
+
+bool effect_burst(effects_t *fx, short x, short y, char color, uint32_t dur_us, uint32_t now_us) {
+    effect_t *e = effect_alloc(fx, EFFECT_BURST, now_us) ;
+    if (!e) return false ;
+    e->x = x ; e->y = y ;
+    e->color = color ;
+    e->dur_us = dur_us ;
+    for (uint i = 0; i < EFFECT_PARTICLES; i++) {
+        // fanned out upwards, each a little different
+        int spread = (int)i * 2 - (EFFECT_PARTICLES - 1) ;
+        fix15 speed = int2fix15((int)(BURST_SPEED_MIN + random_below(fx, BURST_SPEED_RANGE))) ;
+        e->vx[i] = speed * spread / (EFFECT_PARTICLES * 2) ;
+        e->vy[i] = -speed ;
+        e->drawn_x[i] = NO_PIXEL ;
+    }
+    return true ;
+}
+
+void effects_update(effects_t *fx, uint32_t now_us) {
+    for (uint i = 0; i < EFFECTS_MAX; i++) {
+        effect_t *e = &fx->pool[i] ;
+        if (e->kind == EFFECT_FREE) continue ;
+        uint32_t elapsed = now_us - e->start_us ;
+        if (elapsed >= e->dur_us) effect_end(fx, e) ;
+        else if (e->kind == EFFECT_FLASH) flash_update(e, elapsed) ;
+        else burst_update(fx, e, elapsed) ;
+    }
+}
+
+void effects_clear(effects_t *fx) {
+    for (uint i = 0; i < EFFECTS_MAX; i++) {
+        if (fx->pool[i].kind != EFFECT_FREE) effect_end(fx, &fx->pool[i]) ;
+    }
+}
+
+uint effects_active(const effects_t *fx) {
+    uint n = 0 ;
+    for (uint i = 0; i < EFFECTS_MAX; i++) n += fx->pool[i].kind != EFFECT_FREE ;
+    return n ;
+}
@@ -0,0 +1,75 @@
+/**
+ * Timed visual effects for the piano tiles game
+ *
+ * A fixed pool of effects, advanced once per frame by the game loop,
+ * so hit and miss feedback never blocks the loop and any number of
+ * lanes can show it at the same time. Each playfield has its own pool,
+ * so the two halves of the versus screen can be drawn on different
+ * cores.
+ *
+ *  - flash: a solid rectangle, held and then faded out by ordered
+ *    dithering, a few more pixels cleared each frame
+ *  - burst: particles thrown up from a point, falling under gravity
+ *
+ * Effects draw straight into the frame buffer. Whatever an effect
+ * covered is put back through the background callback given to
+ * effects_init(), which repaints a rectangle of the screen. Nothing is
+ * drawn outside the pool's bounds.
+ *
+ */
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include "pico/stdlib.h"
+#include "fix15.h"
+
+#define EFFECTS_MAX         16
+#define EFFECT_PARTICLES    8
+
+#define EFFECT_FREE         0
+#define EFFECT_FLASH        1
+#define EFFECT_BURST        2
+
+typedef struct {
+    uint8_t kind ;
+    char color ;
+    uint8_t level ;             // flash: dither levels cleared so far
+    short x, y, w, h ;          // burst: x, y is where the particles start
+    uint32_t start_us ;
+    uint32_t hold_us ;          // flash: solid time before the fade
+    uint32_t dur_us ;           // whole effect, hold included
+    // burst, velocities in pixels per second
+    fix15 vx[EFFECT_PARTICLES], vy[EFFECT_PARTICLES] ;
+    short drawn_x[EFFECT_PARTICLES], drawn_y[EFFECT_PARTICLES] ;
+} effect_t ;
+
+// Repaints what belongs under a rectangle of the screen; ctx is the
+// one given to effects_init()
+typedef void (*effects_background_t)(void *ctx, short x, short y, short w, short h) ;
+
+typedef struct {
+    effect_t pool[EFFECTS_MAX] ;
+    effects_background_t background ;
+    void *ctx ;
+    short min_x, min_y, max_x, max_y ;
+    uint32_t seed ;
+    uint32_t dropped ;          // effects not started because the pool was full
+} effects_t ;
+
+// Drop every effect; particles stay inside the bounds
+void effects_init(effects_t *fx, effects_background_t background, void *ctx,
+                  short x0, short y0, short x1, short y1) ;
+// Show a rectangle for hold_us, then dither it away over fade_us;
+// drawn at once. False if the pool is full.
+bool effect_flash(effects_t *fx, short x, short y, short w, short h, char color,
+                  uint32_t hold_us, uint32_t fade_us, uint32_t now_us) ;
+// Throw particles up from (x, y) for dur_us; false if the pool is full
+bool effect_burst(effects_t *fx, short x, short y, char color, uint32_t dur_us, uint32_t now_us) ;
+// Advance every effect to now_us and draw what changed
+void effects_update(effects_t *fx, uint32_t now_us) ;
+// Remove every effect from the screen and the pool
+void effects_clear(effects_t *fx) ;
+// Effects running
+uint effects_active(const effects_t *fx) ;
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * ADSR envelope generator for the audio engine
+ *
+ * The curve table holds exp(-k*x) for x in [0,1], normalized to run
+ * from exactly 1.0 down to exactly 0. Attack uses 1 - curve (fast rise,
+ * slow approach to full scale, like a charging RC), decay and release
+ * use the curve directly.
+ *
+ */
+#include "math.h"
+#include "envelope.h"
+
+#define CURVE_SIZE      64
+#define CURVE_END       ((uint32_t)CURVE_SIZE << 16)
+#define CURVE_STEEPNESS 5.0
+
+#define ONEfix15        int2fix15(1)
+
+// one guard entry so interpolation never reads past the end
+static fix15 curve[CURVE_SIZE + 1] ;
+
+void adsr_init_tables() {
+    float floor = exp(-CURVE_STEEPNESS) ;
+    for (int ii = 0; ii <= CURVE_SIZE; ii++) {
+        float x = (float)ii / CURVE_SIZE ;
+        curve[ii] = float2fix15((exp(-CURVE_STEEPNESS*x) - floor) / (1.0 - floor)) ;
+    }
+}
+
+// table lookup with linear interpolation on 15 fraction bits
+static fix15 curve_at(uint32_t pos) {
+    uint32_t index = pos >> 16 ;
+    int frac = (pos >> 1) & 0x7fff ;
+    return curve[index] + (((curve[index+1] - curve[index]) * frac) >> 15) ;
+}
+
+// curve position increment that spans a segment of 'ticks' ticks
+static uint32_t segment_inc(uint16_t ticks) {
+    return ticks ? CURVE_END / ticks : CURVE_END ;
+}
+
+static void enter(adsr_t *env, uint8_t stage, uint16_t ticks) {
+    env->stage = stage ;
+    env->pos = 0 ;
+    env->pos_inc = segment_inc(ticks) ;
+}
+
+void adsr_note_on(adsr_t *env, const adsr_params_t *params, fix15 scale) {
+    env->params = params ;
+    env->scale = scale ;
+    enter(env, ADSR_ATTACK, params->attack) ;
+    // evaluate the first control point on the next sample
+    env->sub = 1 ;
+}
+
+void adsr_note_off(adsr_t *env) {
+    if (env->stage == ADSR_IDLE || env->stage == ADSR_RELEASE) return ;
+    env->from = env->level ;
+    enter(env, ADSR_RELEASE, env->params->release) ;
+}
+
+void adsr_control(adsr_t *env) {
+    const adsr_params_t *p = env->params ;
+    env->sub = ADSR_CONTROL_PERIOD ;
+
+    // advance through the table, moving on at the end of a segment
+    if (env->stage != ADSR_IDLE && env->stage != ADSR_SUSTAIN) {
+        env->pos += env->pos_inc ;
+        if (env->pos >= CURVE_END) {
+            if (env->stage == ADSR_ATTACK) enter(env, ADSR_DECAY, p->decay) ;
+            else if (env->stage == ADSR_DECAY) env->stage = ADSR_SUSTAIN ;
+            else env->stage = ADSR_IDLE ;
+        }
+    }
+
+    switch (env->stage) {
+    case ADSR_ATTACK:
+        env->level = ONEfix15 - curve_at(env->pos) ;
+        break ;
+    case ADSR_DECAY:
+        env->level = p->sustain + multfix15(ONEfix15 - p->sustain, curve_at(env->pos)) ;
+        break ;
+    case ADSR_SUSTAIN:
+        env->level = p->sustain ;
+        break ;
+    case ADSR_RELEASE:
+        env->level = multfix15(env->from, curve_at(env->pos)) ;
+        break ;
+    default:
+        env->level = 0 ;
+        env->out = 0 ;
+        env->step = 0 ;
+        return ;
+    }
+
+    // ramp to the new control point over the next period
+    fix15 target = multfix15(env->level, env->scale) ;
+    env->step = (target - env->out) >> ADSR_CONTROL_SHIFT ;
+}
@@ -0,0 +1,67 @@
+/**
+ * ADSR envelope generator for the audio engine
+ *
+ * Segments follow an exponential curve read from a precomputed table.
+ * The curve is only evaluated at the control rate (once every
+ * ADSR_CONTROL_PERIOD samples); in between, the output moves toward the
+ * next control point by a constant step, so the per-sample cost is one
+ * add and one compare.
+ *
+ * All times are in control ticks, levels are fix15 (1.0 = full scale).
+ *
+ */
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include "pico/stdlib.h"
+#include "fix15.h"
+
+#define ADSR_CONTROL_SHIFT  5
+#define ADSR_CONTROL_PERIOD (1 << ADSR_CONTROL_SHIFT)   // samples per tick
+// convert a time in samples to control ticks
+#define ADSR_TICKS(samples) ((samples) >> ADSR_CONTROL_SHIFT)
+
+// Envelope stages
+#define ADSR_IDLE       0
+#define ADSR_ATTACK     1
+#define ADSR_DECAY      2
+#define ADSR_SUSTAIN    3
+#define ADSR_RELEASE    4
+
+typedef struct {
+    uint16_t attack ;   // ticks from 0 to 1.0
+    uint16_t decay ;    // ticks from 1.0 to the sustain level
+    fix15 sustain ;     // level held until note off
+    uint16_t release ;  // ticks from the current level to 0
+} adsr_params_t ;
+
+typedef struct {
+    const adsr_params_t *params ;
+    fix15 scale ;       // output = curve level * scale (e.g. velocity)
+    fix15 level ;       // unscaled level at the last control point
+    fix15 from ;        // unscaled level where the release started
+    fix15 out ;         // interpolated, scaled output
+    fix15 step ;        // per-sample change of out
+    uint32_t pos ;      // position in the curve table, 16.16
+    uint32_t pos_inc ;  // change of pos per control tick
+    uint8_t stage ;
+    uint8_t sub ;       // samples left until the next control tick
+} adsr_t ;
+
+// Fill the exponential curve table (call once at startup)
+void adsr_init_tables(void) ;
+// Start the attack from wherever the envelope is now (no click on retrigger)
+void adsr_note_on(adsr_t *env, const adsr_params_t *params, fix15 scale) ;
+// Enter the release stage
+void adsr_note_off(adsr_t *env) ;
+// Evaluate the curve for the next control point
+void adsr_control(adsr_t *env) ;
+
+// Next per-sample envelope value
+static inline fix15 adsr_next(adsr_t *env) {
+    if (--env->sub == 0) adsr_control(env) ;
+    env->out += env->step ;
+    return env->out ;
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * Game logic of the piano tiles game, without the hardware
+ *
+ */
+#include "game.h"
+
+#define LANE_BIT(lane) (1u << (lane))
+
+// Step at which a chart tick arrives at the hit line, the nearest to
+// its time from step 0
+static uint32_t chart_step(const game_t *g, uint32_t tick) {
+    uint32_t ticks_per_min = g->chart_bpm * g->chart_ticks_per_beat ;
+    return ((uint64_t)(tick + g->lead_ticks) * LOGIC_HZ * 60 + ticks_per_min / 2) / ticks_per_min ;
+}
+
+void game_init(game_t *g, const uint8_t *chart, uint lanes, uint64_t start_us) {
+    playfield_layout(&g->pf, lanes) ;
+    scroll_init(&g->scroll, SCROLL_SPEED(SPEED_START_PX_S, LOGIC_HZ),
+                SCROLL_SPEED(SPEED_MAX_PX_S, LOGIC_HZ), SPEED_RAMP_S * LOGIC_HZ) ;
+    beatmap_reader_init(&g->chart, chart, true) ;
+    g->chart_bpm = beatmap_bpm(chart) ;
+    g->chart_ticks_per_beat = beatmap_ticks_per_beat(chart) ;
+    judge_init(&g->judge, &judge_default_windows) ;
+    // the chart starts one fall (at the start speed) into the game,
+    // rounded up to a beat
+    uint64_t fall_steps = FALL_DISTANCE / g->scroll.v0 ;
+    uint32_t beats = (fall_steps * g->chart_bpm + LOGIC_HZ * 60 - 1) / (LOGIC_HZ * 60) ;
+    g->lead_ticks = beats * g->chart_ticks_per_beat ;
+    g->step = 0 ;
+    g->start_us = start_us ;
+    g->retire_hook = NULL ;
+    g->hook_ctx = NULL ;
+    g->hits = g->missed = 0 ;
+    g->hit_input_us = 0 ;
+    g->last_grade = JUDGE_NONE ;
+    g->over = false ;
+    g->tiles_spawned = g->tiles_arrived = 0 ;
+    g->press_hits = 0 ;
+    g->press_hit_us = 0 ;
+}
+
+uint32_t game_press(game_t *g, uint input_lane, uint64_t time_us) {
+    uint32_t lanes = g->pf.input_lanes[input_lane], hit = 0 ;
+    for (uint lane = 0; lanes; lane++, lanes >>= 1) {
+        if (!(lanes & 1)) continue ;
+        int grade = judge_press(&g->judge, lane, time_us) ;
+        if (grade == JUDGE_NONE) continue ;
+        if (!g->press_hits) g->press_hit_us = time_us ;
+        g->press_hits |= LANE_BIT(lane) ;
+        g->last_grade = grade ;
+        hit |= LANE_BIT(lane) ;
+    }
+    return hit ;
+}
+
+void game_step(game_t *g, uint32_t latency_us) {
+    playfield_t *pf = &g->pf ;
+    const beatmap_note_t *note ;
+    beatmap_note_t spawned ;
+    uint64_t now = game_step_us(g, g->step) ;
+
+    g->hits = g->press_hits ;
+    g->hit_input_us = g->press_hit_us ;
+    g->press_hits = 0 ;
+
+    // Spawn the chart's notes once the scroll is one fall away from
+    // where it will be at their arrival; chart lanes beyond the
+    // playfield wrap
+    while ((note = beatmap_peek(&g->chart, 0))) {
+        uint32_t arrival = chart_step(g, note->tick) ;
+        uint64_t arrival_pos = scroll_at(&g->scroll, arrival) ;
+        if (arrival > g->step && arrival_pos - g->scroll.pos > FALL_DISTANCE) break ;
+        for (uint bit = 0; bit < 8; bit++) {
+            if (!(note->lanes & (1u << bit))) continue ;
+            if (playfield_spawn(pf, bit % pf->count, arrival, scroll_pos16(arrival_pos))) g->tiles_spawned++ ;
+        }
+        beatmap_next(&g->chart, &spawned) ;
+    }
+
+    // A tile arrives when it reaches the hit line. The judge grades it
+    // against the press times, waiting out the late window; tiles
+    // arriving together form a chord, and missing any of its lanes
+    // ends the game.
+    for (uint lane = 0; lane < pf->count; lane++) {
+        while (playfield_tiles(pf, lane) &&
+               pf->tile_arrival[lane][playfield_slot(pf, lane, 0)] <= g->step) {
+            uint64_t arrival_us = game_step_us(g, pf->tile_arrival[lane][playfield_slot(pf, lane, 0)]) ;
+            if (g->retire_hook) g->retire_hook(g->hook_ctx, lane) ;
+            playfield_retire(pf, lane) ;
+            g->tiles_arrived++ ;
+            int grade = judge_tile(&g->judge, lane, arrival_us) ;
+            if (grade != JUDGE_NONE) {
+                // an early press: the reaction starts at the arrival
+                if (!g->hits) g->hit_input_us = arrival_us ;
+                g->hits |= LANE_BIT(lane) ;
+                g->last_grade = grade ;
+            }
+        }
+    }
+    g->missed = judge_expire(&g->judge, now - latency_us) ;
+    if (g->missed) g->over = true ;
+
+    scroll_step(&g->scroll) ;
+    g->step++ ;
+}
+
+void game_shift(game_t *g, uint64_t dt_us) {
+    g->start_us += dt_us ;
+    judge_shift(&g->judge, dt_us) ;
+}
+
+uint64_t game_scroll_at_us(const game_t *g, uint64_t time_us) {
+    if (time_us <= g->start_us) return 0 ;
+    // steps since the start, and the remainder in millionths of a step
+    uint64_t t = (time_us - g->start_us) * LOGIC_HZ ;
+    uint32_t step = t / 1000000 ;
+    uint32_t part = t % 1000000 ;
+    uint64_t pos = scroll_at(&g->scroll, step) ;
+    return pos + (scroll_at(&g->scroll, step + 1) - pos) * part / 1000000 ;
+}
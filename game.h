@@ -0,0 +1,94 @@
+/**
+ * Game logic of the piano tiles game, without the hardware
+ *
+ * The tiles in each lane, their motion, the chart they come from, the
+ * judgment of presses and the score, advanced one fixed logic step at a
+ * time. Time comes only from the step number: step n is n/LOGIC_HZ
+ * seconds after start_us, exactly, so the steps keep in time with the
+ * song's samples. A game stepped on a PC with a simulated clock and
+ * scripted presses therefore plays exactly as on the device
+ * (tools/game_sim.c).
+ *
+ * The chart's tick 0 arrives a whole number of beats into the game, so
+ * a song started with the game's step 0 plays its beats as the tiles
+ * that belong to them reach the hit line.
+ *
+ * Drawing, sound and the input hardware stay with the caller. It hands
+ * in the presses, runs game_step() when a step is due, and reads what
+ * the step did from hits, missed and over.
+ *
+ */
+#ifndef GAME_H
+#define GAME_H
+
+#include "pico/stdlib.h"
+#include "playfield.h"
+#include "scroll.h"
+#include "beatmap.h"
+#include "judge.h"
+
+// Game logic runs in fixed steps of about LOGIC_STEP_US
+#define LOGIC_HZ        240
+#define LOGIC_STEP_US   (1000000/LOGIC_HZ)
+// tiles arrive when their top reaches this line
+#define ARRIVAL_Y       356
+// a tile spawns just above the screen, this far from arriving
+#define FALL_DISTANCE   ((uint64_t)(ARRIVAL_Y + TILE_H) << 32)
+// Difficulty ramp: the tiles start at the original 40 pixels a second
+// and speed up steadily to SPEED_MAX_PX_S over SPEED_RAMP_S seconds
+#define SPEED_START_PX_S 40
+#define SPEED_MAX_PX_S  120
+#define SPEED_RAMP_S    120
+
+// Called with a playfield lane just before its oldest tile leaves the
+// ring, so the caller can take it off the screen; ctx is the game's
+// hook_ctx
+typedef void (*game_retire_hook_t)(void *ctx, uint lane) ;
+
+typedef struct {
+    playfield_t pf ;
+    scroll_t scroll ;
+    beatmap_reader_t chart ;
+    judge_t judge ;
+    uint chart_bpm ;
+    uint chart_ticks_per_beat ;
+    uint32_t lead_ticks ;       // chart ticks before its tick 0 arrives, whole beats
+    uint32_t step ;             // the next step to run
+    uint64_t start_us ;         // time of step 0
+    game_retire_hook_t retire_hook ;
+    void *hook_ctx ;
+    // what the last game_step() did
+    uint32_t hits ;             // lanes hit, by a press or by an arrival
+    uint32_t missed ;           // lanes whose tile was missed
+    uint64_t hit_input_us ;     // press (or arrival) time of the first hit
+    int last_grade ;
+    bool over ;                 // a miss ends the game
+    // totals, for checking the logic
+    uint32_t tiles_spawned ;
+    uint32_t tiles_arrived ;
+    // private: hits by presses since the last step
+    uint32_t press_hits ;
+    uint64_t press_hit_us ;
+} game_t ;
+
+// A new game of a chart (beatmap.h) on `lanes` playfield lanes, with
+// step 0 at start_us
+void game_init(game_t *g, const uint8_t *chart, uint lanes, uint64_t start_us) ;
+// Time of a logic step
+static inline uint64_t game_step_us(const game_t *g, uint32_t step) {
+    return g->start_us + (uint64_t)step * 1000000 / LOGIC_HZ ;
+}
+// A press of an input lane at time_us, judged in every playfield lane
+// it drives; returns the playfield lanes it hit
+uint32_t game_press(game_t *g, uint input_lane, uint64_t time_us) ;
+// Run the next step: spawn the chart's notes, judge the tiles arriving,
+// and count as missed those whose late window closed latency_us before
+// the step (a press can still be that far behind, in the input filter)
+void game_step(game_t *g, uint32_t latency_us) ;
+// Move the game's clock on by dt_us, after a pause
+void game_shift(game_t *g, uint64_t dt_us) ;
+// Scroll position (32.32 px) at any time, between steps too: the
+// distance at the step before plus that step's speed for the time since
+uint64_t game_scroll_at_us(const game_t *g, uint64_t time_us) ;
+
+#endif
@@ -0,0 +1,265 @@
+/**
+ * Lane input for the piano tiles game
+ *
+ * Backends turn select line changes into lane samples:
+ *  - INPUT_GPIO_IRQ: edge interrupts on both edges of the select lines,
+ *    stamped with the 64-bit µs timer inside the interrupt and queued
+ *    raw for input_poll().
+ *  - INPUT_POLLED: the original gpio_get() sampling, only as precise as
+ *    the rate input_poll() is called at.
+ *  - INPUT_ADC_DMA: analog flex sensors captured by the ADC and DMA,
+ *    scaled by their calibration (input_adc.c). There are only four
+ *    ADC inputs, so player 2's lanes are polled from the select lines.
+ *  - INPUT_PIO: the select lines sampled at 100 kHz by a PIO state
+ *    machine per glove, changes queued raw like the interrupt's
+ *    (input_pio.c).
+ * Every sample then goes through its lane's filter, which decides when
+ * a press or release is reported.
+ *
+ */
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "input.h"
+#include "input_adc.h"
+#include "input_pio.h"
+#include "input_record.h"
+
+// ring: filtered lane events for the game
+// raw: pin changes from the GPIO interrupt, waiting for input_poll()
+static input_ring_t ring ;
+static input_ring_t raw ;
+static int input_backend ;
+
+static const input_filter_params_t *filter ;
+static input_filter_params_t irq_filter ;
+static lane_filter_t lane_filter[NUM_LANES] ;
+static uint32_t sample_us ;
+
+// Debounced state of each lane, bit n = lane n
+static uint32_t lane_state ;
+// Pin level of the last raw change of each lane, used to drop repeated
+// edges (an IRQ for a glitch shorter than the interrupt latency)
+static uint32_t raw_state ;
+
+// Replay of a recorded stream, which stands in for the backend while
+// it lasts
+static input_stream_t replay ;
+static input_event_t replay_next ;
+static uint64_t replay_start ;
+static bool replay_on ;
+
+// lanes in order of their select line
+static const uint lane_pins[NUM_LANES] = {
+    SELECT_LINE_A, SELECT_LINE_B, SELECT_LINE_C, SELECT_LINE_D,
+    SELECT2_LINE_A, SELECT2_LINE_B, SELECT2_LINE_C, SELECT2_LINE_D
+} ;
+
+static bool ring_push(input_ring_t *r, uint8_t lane, uint8_t edge, uint64_t time_us) {
+    uint32_t head = r->head ;
+    if (head - r->tail == INPUT_RING_SIZE) {
+        r->dropped++ ;
+        return false ;
+    }
+    input_event_t *e = &r->events[head & (INPUT_RING_SIZE - 1)] ;
+    e->time_us = time_us ;
+    e->lane = lane ;
+    e->edge = edge ;
+    // publish the slot only after it is filled
+    __dmb() ;
+    r->head = head + 1 ;
+    return true ;
+}
+
+static bool ring_pop(input_ring_t *r, input_event_t *event) {
+    uint32_t tail = r->tail ;
+    if (tail == r->head) return false ;
+    __dmb() ;
+    *event = r->events[tail & (INPUT_RING_SIZE - 1)] ;
+    r->tail = tail + 1 ;
+    return true ;
+}
+
+bool input_push_event(uint8_t lane, uint8_t edge, uint64_t time_us) {
+    input_event_t e = { time_us, lane, edge } ;
+    input_record_event(&e) ;
+    return ring_push(&ring, lane, edge, time_us) ;
+}
+
+bool input_get_event(input_event_t *event) {
+    return ring_pop(&ring, event) ;
+}
+
+uint32_t input_lanes_down() {
+    return lane_state ;
+}
+
+fix15 input_lane_value(uint lane) {
+    return lane_filter[lane].y ;
+}
+
+void input_lane_level(uint lane, bool pressed, uint64_t now) {
+    uint32_t bit = 1u << lane ;
+    if (((raw_state & bit) != 0) == pressed) return ;
+    raw_state ^= bit ;
+    ring_push(&raw, lane, pressed ? INPUT_PRESS : INPUT_RELEASE, now) ;
+}
+
+void input_lane_sample(uint lane, fix15 level, uint64_t now) {
+    uint64_t edge_time ;
+    lane_filter_t *f = &lane_filter[lane] ;
+    if (!lane_filter_update(f, filter, level, now, &edge_time)) return ;
+    bool down = lane_filter_down(f) ;
+    lane_state ^= 1u << lane ;
+    input_push_event(lane, down ? INPUT_PRESS : INPUT_RELEASE, edge_time) ;
+}
+
+// GPIO interrupt, runs on the core that called input_init()
+static void select_line_irq(uint gpio, uint32_t events) {
+    uint64_t now = time_us_64() ;
+    uint lane = 0 ;
+    while (lane < NUM_LANES && lane_pins[lane] != gpio) lane++ ;
+    if (lane == NUM_LANES) return ;
+    // both edges may be latched if the pin bounced; the pin level now
+    // is what counts
+    if (events & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL)) {
+        input_lane_level(lane, gpio_get(gpio), now) ;
+    }
+}
+
+void input_replay_start(const uint8_t *stream, uint32_t len, uint64_t start_us) {
+    input_stream_init(&replay, stream, len) ;
+    replay_start = start_us ;
+    replay_on = input_stream_next(&replay, &replay_next) ;
+    lane_state = 0 ;
+}
+
+bool input_replaying() {
+    return replay_on ;
+}
+
+// Queue the recorded events that are due by now
+static void replay_poll(uint64_t now) {
+    while (replay_on && replay_start + replay_next.time_us <= now) {
+        uint32_t bit = 1u << replay_next.lane ;
+        if (replay_next.edge == INPUT_PRESS) lane_state |= bit ;
+        else lane_state &= ~bit ;
+        ring_push(&ring, replay_next.lane, replay_next.edge, replay_start + replay_next.time_us) ;
+        replay_on = input_stream_next(&replay, &replay_next) ;
+    }
+    if (!replay_on) {
+        // hand back to the backend with the lanes as its filters see them
+        lane_state = 0 ;
+        for (uint lane = 0; lane < NUM_LANES; lane++) {
+            if (lane_filter_down(&lane_filter[lane])) lane_state |= 1u << lane ;
+        }
+    }
+}
+
+void input_poll() {
+    uint64_t now = time_us_64() ;
+    input_event_t e ;
+
+    if (replay_on) {
+        // live edges are dropped as they come, rather than left to fill
+        // the raw ring and reach the filters stale when the replay ends;
+        // raw_state still follows the pins for the hand back
+        if (input_backend == INPUT_PIO) pio_input_process() ;
+        while (ring_pop(&raw, &e)) ;
+        replay_poll(now) ;
+        return ;
+    }
+
+    switch (input_backend) {
+    case INPUT_ADC_DMA:
+        adc_input_process() ;
+        for (uint lane = ADC_LANES; lane < NUM_LANES; lane++) {
+            input_lane_sample(lane, int2fix15(gpio_get(lane_pins[lane])), now) ;
+        }
+        break ;
+    case INPUT_PIO:
+        pio_input_process() ;
+        // fall through: the changes are now queued as raw levels
+    case INPUT_GPIO_IRQ:
+        while (ring_pop(&raw, &e)) {
+            input_lane_sample(e.lane, int2fix15(e.edge == INPUT_PRESS), e.time_us) ;
+        }
+        // read after the drain, so no edge taken above is later than now
+        now = time_us_64() ;
+        // let pending transitions that have held long enough through
+        for (uint lane = 0; lane < NUM_LANES; lane++) {
+            input_lane_sample(lane, int2fix15((raw_state >> lane) & 1), now) ;
+        }
+        break ;
+    case INPUT_POLLED:
+        for (uint lane = 0; lane < NUM_LANES; lane++) {
+            input_lane_sample(lane, int2fix15(gpio_get(lane_pins[lane])), now) ;
+        }
+        break ;
+    }
+}
+
+uint32_t input_latency_us() {
+    return input_filter_latency_us(filter, sample_us) ;
+}
+
+const char *input_filter_name() {
+    return filter->name ;
+}
+
+void input_init(int backend, int preset) {
+    input_backend = backend ;
+    filter = &input_filter_presets[preset] ;
+    switch (backend) {
+    case INPUT_ADC_DMA:
+        sample_us = 1000000 / ADC_LANE_RATE ;
+        break ;
+    case INPUT_GPIO_IRQ:
+    case INPUT_PIO:
+        // edges arrive at irregular times, so there is no sample rate
+        // for a low pass; the debounce alone deals with chatter
+        irq_filter = *filter ;
+        irq_filter.shift = 0 ;
+        filter = &irq_filter ;
+        sample_us = backend == INPUT_PIO ? PIO_SAMPLE_US : 0 ;
+        break ;
+    default:
+        sample_us = INPUT_POLL_US ;
+        break ;
+    }
+    lane_state = 0 ;
+    raw_state = 0 ;
+    for (uint lane = 0; lane < NUM_LANES; lane++) {
+        lane_filter_init(&lane_filter[lane], filter) ;
+    }
+
+    for (uint lane = 0; lane < NUM_LANES; lane++) {
+        gpio_init(lane_pins[lane]) ;
+        gpio_set_dir(lane_pins[lane], GPIO_IN) ;
+        // a glove that is not plugged in reads as released
+        gpio_pull_down(lane_pins[lane]) ;
+    }
+
+    if (backend == INPUT_ADC_DMA) {
+        adc_input_start() ;
+    }
+    else if (backend == INPUT_PIO) {
+        pio_input_start() ;
+    }
+    else if (backend == INPUT_GPIO_IRQ) {
+        // one callback serves every GPIO on this core
+        gpio_set_irq_enabled_with_callback(lane_pins[0],
+            GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, &select_line_irq) ;
+        for (uint lane = 1; lane < NUM_LANES; lane++) {
+            gpio_set_irq_enabled(lane_pins[lane],
+                GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true) ;
+        }
+    }
+}
+
+uint16_t input_analog(uint lane) {
+    if (lane >= ADC_LANES) return 0 ;
+    if (input_backend == INPUT_ADC_DMA) return adc_input_raw(lane) ;
+    // the ADC is free for one-shot reads in the other modes
+    adc_select_input(lane) ;
+    return adc_read() ;
+}
@@ -0,0 +1,103 @@
+/**
+ * Lane input for the piano tiles game
+ *
+ * Every change of a lane (finger bent past threshold, or released) is
+ * turned into a timestamped event and queued in a lock-free ring, so the
+ * game sees every press with the time it happened. Lane samples go
+ * through the lane filter (input_filter.h) first; interrupt backends
+ * only queue the raw pin changes, and input_poll() filters them.
+ *
+ * Lanes 1..4 are player 1's glove and lanes 5..8 player 2's, for the
+ * versus mode; a glove that is not connected reads as never pressed.
+ *
+ * HARDWARE CONNECTIONS
+ *  - GPIO 10 <--- lane 1 select line (flex sensor comparator)
+ *  - GPIO 11 <--- lane 2 select line
+ *  - GPIO 12 <--- lane 3 select line
+ *  - GPIO 13 <--- lane 4 select line
+ *  - GPIO 0, 1, 21, 22 <--- lanes 5..8, player 2's select lines (UART
+ *    stdio is off; GPIO 2 is the restart button, 26..29 the ADC)
+ *
+ */
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "pico/stdlib.h"
+#include "fix15.h"
+#include "input_filter.h"
+
+#define SELECT_LINE_A 10
+#define SELECT_LINE_B 11
+#define SELECT_LINE_C 12
+#define SELECT_LINE_D 13
+#define SELECT2_LINE_A 0
+#define SELECT2_LINE_B 1
+#define SELECT2_LINE_C 21
+#define SELECT2_LINE_D 22
+#define LANES_PER_PLAYER 4
+#define NUM_PLAYERS   2
+#define NUM_LANES     (LANES_PER_PLAYER*NUM_PLAYERS)
+// input lanes of a player, as a mask
+#define PLAYER_LANES(player) (((1u << LANES_PER_PLAYER) - 1) << ((player)*LANES_PER_PLAYER))
+
+// Where lane events come from
+#define INPUT_POLLED    0   // gpio_get() from input_poll()
+#define INPUT_GPIO_IRQ  1   // edge interrupts on the select lines
+#define INPUT_ADC_DMA   2   // analog flex sensors through ADC + DMA
+#define INPUT_PIO       3   // select lines sampled by a PIO state machine
+
+// input_poll() period (the input thread's rate), for the polled
+// backend's latency figure
+#define INPUT_POLL_US   1000
+
+// Event edges
+#define INPUT_RELEASE   0
+#define INPUT_PRESS     1
+
+typedef struct {
+    uint64_t time_us ;  // time of the edge, µs since boot
+    uint8_t lane ;      // 0..NUM_LANES-1
+    uint8_t edge ;      // INPUT_PRESS or INPUT_RELEASE
+} input_event_t ;
+
+// Single-producer single-consumer ring. Only the producer writes head
+// and only the consumer writes tail, so no locks are needed.
+#define INPUT_RING_SIZE 64  // power of two
+typedef struct {
+    input_event_t events[INPUT_RING_SIZE] ;
+    volatile uint32_t head ;
+    volatile uint32_t tail ;
+    volatile uint32_t dropped ; // events lost to a full ring
+} input_ring_t ;
+
+// Set up the select lines and start the chosen backend, filtering
+// with one of the input_filter_presets
+void input_init(int backend, int filter) ;
+// Sample polled backends and run the lane filters
+void input_poll(void) ;
+// Pop the oldest event; false when there is none
+bool input_get_event(input_event_t *event) ;
+// Queue an event (used by the backends)
+bool input_push_event(uint8_t lane, uint8_t edge, uint64_t time_us) ;
+// Queue a raw pin change from an interrupt backend, filtered later by
+// input_poll()
+void input_lane_level(uint lane, bool pressed, uint64_t time_us) ;
+// Run one sample of a lane (0..1.0) through its filter, queueing an
+// event when the debounced state changes (input_poll() context only)
+void input_lane_sample(uint lane, fix15 level, uint64_t time_us) ;
+// Bitmask of lanes whose last event was a press (bit n = lane n)
+uint32_t input_lanes_down(void) ;
+// Filtered level of a lane (0..1.0)
+fix15 input_lane_value(uint lane) ;
+// Feed a recorded stream (input_record.h) to the game instead of the
+// backend, event times counted from start_us, until the stream ends
+void input_replay_start(const uint8_t *stream, uint32_t len, uint64_t start_us) ;
+bool input_replaying(void) ;
+// Latency the lane filter adds to a press with the chosen backend
+uint32_t input_latency_us(void) ;
+// Name of the filter preset in use
+const char *input_filter_name(void) ;
+// ADC code of a lane's analog sensor (for display and calibration)
+uint16_t input_analog(uint lane) ;
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * Free-running ADC capture of the analog flex sensors
+ *
+ * DMA channel 4 is paced by the ADC FIFO and writes into a ring whose
+ * wrap is done by the DMA address ring hardware. When its transfer
+ * count runs out it chains to channel 5, which writes the count back
+ * into channel 4's trigger register, so capture never stops. Because
+ * the ring holds a whole number of round-robin passes, ring index i
+ * always holds lane i % ADC_LANES.
+ *
+ */
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "input_adc.h"
+
+#define ADC_RING_BITS       11                          // 2 kBytes
+#define ADC_RING_SAMPLES    ((1 << ADC_RING_BITS) / 2)
+#define ADC_RING_MASK       (ADC_RING_SAMPLES - 1)
+#define ADC_DMA_CHAN        4
+#define ADC_CTRL_CHAN       5
+#define ADC_FIRST_GPIO      26
+#define ADC_CLOCK_HZ        48000000
+#define ADC_SAMPLE_US       (1000000/ADC_SAMPLE_RATE)
+
+// Calibration lives in the last flash sector
+#define ADC_CAL_MAGIC       0xF1E85E75
+#define ADC_CAL_OFFSET      (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define ADC_CAL_FLASH       ((const adc_calibration_t *)(XIP_BASE + ADC_CAL_OFFSET))
+// used until the sensors have been calibrated once
+#define ADC_DEFAULT_REST    1000
+#define ADC_DEFAULT_FULL    3000
+#define ADC_MIN_RANGE       16
+
+static uint16_t adc_ring[ADC_RING_SAMPLES] __attribute__((aligned(1 << ADC_RING_BITS))) ;
+// reloaded into the sample channel by the control channel
+static uint32_t adc_ring_transfers = ADC_RING_SAMPLES ;
+static uint32_t read_index ;
+
+static uint16_t last_raw[ADC_LANES] ;
+static fix15 bend[ADC_LANES] ;
+static adc_calibration_t cal ;
+static int bend_scale[ADC_LANES] ;      // fix15 per ADC code, << 8
+
+static void use_calibration(const adc_calibration_t *c) {
+    cal = *c ;
+    for (uint lane = 0; lane < ADC_LANES; lane++) {
+        int range = (int)cal.full[lane] - (int)cal.rest[lane] ;
+        // sensors may read lower when bent, so the range can be negative
+        if (range >= 0 && range < ADC_MIN_RANGE) range = ADC_MIN_RANGE ;
+        if (range < 0 && range > -ADC_MIN_RANGE) range = -ADC_MIN_RANGE ;
+        bend_scale[lane] = (int2fix15(1) << 8) / range ;
+    }
+}
+
+static void load_calibration(void) {
+    if (ADC_CAL_FLASH->magic == ADC_CAL_MAGIC) {
+        use_calibration(ADC_CAL_FLASH) ;
+        return ;
+    }
+    adc_calibration_t defaults ;
+    for (uint lane = 0; lane < ADC_LANES; lane++) {
+        defaults.rest[lane] = ADC_DEFAULT_REST ;
+        defaults.full[lane] = ADC_DEFAULT_FULL ;
+    }
+    use_calibration(&defaults) ;
+}
+
+void adc_input_save_calibration(const adc_calibration_t *c) {
+    static uint8_t page[FLASH_PAGE_SIZE] ;
+    memset(page, 0xff, sizeof(page)) ;
+    memcpy(page, c, sizeof(*c)) ;
+    ((adc_calibration_t *)page)->magic = ADC_CAL_MAGIC ;
+
+    // no code may run from flash while it is erased and programmed
+    uint32_t ints = save_and_disable_interrupts() ;
+    flash_range_erase(ADC_CAL_OFFSET, FLASH_SECTOR_SIZE) ;
+    flash_range_program(ADC_CAL_OFFSET, page, FLASH_PAGE_SIZE) ;
+    restore_interrupts(ints) ;
+
+    load_calibration() ;
+}
+
+void adc_input_start() {
+    load_calibration() ;
+
+    adc_init() ;
+    for (uint lane = 0; lane < ADC_LANES; lane++) {
+        adc_gpio_init(ADC_FIRST_GPIO + lane) ;
+        last_raw[lane] = cal.rest[lane] ;
+    }
+    // round robin starts from input 0, so ring index 0 is lane 0
+    adc_select_input(0) ;
+    adc_set_round_robin((1u << ADC_LANES) - 1) ;
+    // FIFO on, DREQ on at one sample, no error bit, keep 12 bits
+    adc_fifo_setup(true, true, 1, false, false) ;
+    adc_set_clkdiv(ADC_CLOCK_HZ / ADC_SAMPLE_RATE - 1) ;
+
+    dma_channel_claim(ADC_DMA_CHAN) ;
+    dma_channel_claim(ADC_CTRL_CHAN) ;
+
+    // Channel Four (ADC FIFO into the sample ring)
+    dma_channel_config c4 = dma_channel_get_default_config(ADC_DMA_CHAN) ;
+    channel_config_set_transfer_data_size(&c4, DMA_SIZE_16) ;
+    channel_config_set_read_increment(&c4, false) ;
+    channel_config_set_write_increment(&c4, true) ;
+    channel_config_set_ring(&c4, true, ADC_RING_BITS) ;             // wrap writes
+    channel_config_set_dreq(&c4, DREQ_ADC) ;
+    channel_config_set_chain_to(&c4, ADC_CTRL_CHAN) ;
+
+    dma_channel_configure(
+        ADC_DMA_CHAN,
+        &c4,
+        adc_ring,                   // write address (sample ring)
+        &adc_hw->fifo,              // read address (ADC FIFO)
+        ADC_RING_SAMPLES,
+        false
+    ) ;
+
+    // Channel Five (restarts channel four)
+    dma_channel_config c5 = dma_channel_get_default_config(ADC_CTRL_CHAN) ;
+    channel_config_set_transfer_data_size(&c5, DMA_SIZE_32) ;
+    channel_config_set_read_increment(&c5, false) ;
+    channel_config_set_write_increment(&c5, false) ;
+
+    dma_channel_configure(
+        ADC_CTRL_CHAN,
+        &c5,
+        &dma_hw->ch[ADC_DMA_CHAN].al1_transfer_count_trig,
+        &adc_ring_transfers,
+        1,
+        false
+    ) ;
+
+    read_index = 0 ;
+    dma_start_channel_mask(1u << ADC_DMA_CHAN) ;
+    adc_run(true) ;
+}
+
+static uint32_t write_index(void) {
+    return ((dma_hw->ch[ADC_DMA_CHAN].write_addr - (uint32_t)(uintptr_t)adc_ring) / 2) & ADC_RING_MASK ;
+}
+
+void adc_input_process() {
+    uint32_t head = write_index() ;
+    uint32_t behind = (head - read_index) & ADC_RING_MASK ;
+    uint64_t now = time_us_64() ;
+
+    while (read_index != head) {
+        uint lane = read_index % ADC_LANES ;
+        int raw = adc_ring[read_index] & 0xfff ;
+        behind-- ;
+
+        last_raw[lane] = raw ;
+        bend[lane] = ((raw - cal.rest[lane]) * bend_scale[lane]) >> 8 ;
+        // keep overshoot from slowing the filter's way back
+        if (bend[lane] < 0) bend[lane] = 0 ;
+        if (bend[lane] > int2fix15(1)) bend[lane] = int2fix15(1) ;
+
+        // the sample was taken 'behind' sample periods before now
+        input_lane_sample(lane, bend[lane], now - behind*ADC_SAMPLE_US) ;
+        read_index = (read_index + 1) & ADC_RING_MASK ;
+    }
+}
+
+fix15 adc_input_bend(uint lane) {
+    return bend[lane] ;
+}
+
+uint16_t adc_input_raw(uint lane) {
+    return last_raw[lane] ;
+}
+
+void adc_input_average(uint16_t out[ADC_LANES]) {
+    // the last 64 passes of the round robin
+    const uint32_t passes = 64 ;
+    uint32_t sum[ADC_LANES] = {0} ;
+    uint32_t head = write_index() & ~(uint32_t)(ADC_LANES - 1) ;
+    for (uint32_t n = 1; n <= passes*ADC_LANES; n++) {
+        uint32_t i = (head - n) & ADC_RING_MASK ;
+        sum[i % ADC_LANES] += adc_ring[i] & 0xfff ;
+    }
+    for (uint lane = 0; lane < ADC_LANES; lane++) {
+        out[lane] = sum[lane] / passes ;
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * Free-running ADC capture of the analog flex sensors
+ *
+ * The ADC converts the lane inputs round-robin on its own clock and a
+ * DMA channel streams the results into a ring in SRAM, so capturing a
+ * sample costs the CPUs nothing. adc_input_process() works through the
+ * samples that arrived since its last call: each one goes through the
+ * lane's filter, and crossing the press threshold becomes a lane event
+ * timestamped from the sample's position in the stream.
+ *
+ * Per-lane calibration (ADC code at rest and at full bend) is kept in
+ * the last sector of flash.
+ *
+ * HARDWARE CONNECTIONS
+ *  - GPIO 26..29 (ADC0..ADC3) <--- flex sensor dividers, lanes 1..4
+ *    (on a stock Pico board GPIO 29 is wired to VSYS/3, so lane 4
+ *    needs a board that breaks out ADC3)
+ *
+ * RESOURCES USED
+ *  - ADC in round-robin free-running mode
+ *  - DMA channels 4 (samples) and 5 (restarts channel 4)
+ *  - 2 kBytes of RAM for the sample ring
+ *
+ */
+#ifndef INPUT_ADC_H
+#define INPUT_ADC_H
+
+#include "pico/stdlib.h"
+#include "fix15.h"
+#include "input.h"
+
+// lanes with an analog sensor (ADC0..ADC3), a power of two
+#define ADC_LANES           4
+// conversions per second for each lane
+#define ADC_LANE_RATE       1000
+#define ADC_SAMPLE_RATE     (ADC_LANE_RATE*ADC_LANES)
+
+typedef struct {
+    uint32_t magic ;
+    uint16_t rest[ADC_LANES] ;  // ADC code with the finger straight
+    uint16_t full[ADC_LANES] ;  // ADC code with the finger fully bent
+} adc_calibration_t ;
+
+// Start conversions and the DMA ring
+void adc_input_start(void) ;
+// Feed the samples captured since the last call to the lane filters
+void adc_input_process(void) ;
+// Latest calibrated bend of a lane (0 = rest, 1.0 = full bend);
+// input_lane_value() is the filtered one
+fix15 adc_input_bend(uint lane) ;
+// Latest ADC code of a lane
+uint16_t adc_input_raw(uint lane) ;
+// Average of the most recent samples of every lane (for calibration)
+void adc_input_average(uint16_t out[ADC_LANES]) ;
+// Use, and store in flash, a new calibration. Only call this before
+// core 1 is started: flash is unavailable to both cores while it is
+// being written.
+void adc_input_save_calibration(const adc_calibration_t *cal) ;
+
+#endif
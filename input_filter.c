@@ -0,0 +1,93 @@
+/**
+ * Lane input filter: low pass, hysteresis and adaptive debounce
+ *
+ */
+#include "input_filter.h"
+
+const input_filter_params_t input_filter_presets[NUM_FILTER_PRESETS] = {
+    [FILTER_FAST]     = { "fast",     1, float2fix15(0.50), float2fix15(0.35),  500,  4000 },
+    [FILTER_BALANCED] = { "balanced", 2, float2fix15(0.55), float2fix15(0.30), 1000,  8000 },
+    [FILTER_SMOOTH]   = { "smooth",   4, float2fix15(0.60), float2fix15(0.25), 2000, 16000 },
+} ;
+
+void lane_filter_init(lane_filter_t *f, const input_filter_params_t *p) {
+    f->y = 0 ;
+    f->debounce_us = p->debounce_min_us ;
+    f->since = 0 ;
+    f->bounces = 0 ;
+    f->state = LANE_UP ;
+}
+
+// a pending transition fell back: assume a noisier sensor
+static void bounced(lane_filter_t *f, const input_filter_params_t *p) {
+    f->bounces++ ;
+    f->debounce_us <<= 1 ;
+    if (f->debounce_us > p->debounce_max_us) f->debounce_us = p->debounce_max_us ;
+}
+
+// a transition held: relax toward the minimum by 1/8
+static void settled(lane_filter_t *f, const input_filter_params_t *p) {
+    f->debounce_us -= (f->debounce_us - p->debounce_min_us) >> 3 ;
+}
+
+// Time the pending transition has held at t. A sample older than the
+// transition (an edge queued while the caller read its clock) has
+// held for no time.
+static uint64_t held_us(const lane_filter_t *f, uint64_t t) {
+    return t > f->since ? t - f->since : 0 ;
+}
+
+bool lane_filter_update(lane_filter_t *f, const input_filter_params_t *p,
+                        fix15 x, uint64_t t, uint64_t *edge_time) {
+    f->y += (x - f->y) >> p->shift ;
+
+    switch (f->state) {
+    case LANE_UP:
+        if (f->y >= p->press_level) {
+            f->state = LANE_PRESS_PENDING ;
+            f->since = t ;
+        }
+        break ;
+    case LANE_PRESS_PENDING:
+        if (f->y < p->press_level) {
+            f->state = LANE_UP ;
+            bounced(f, p) ;
+        }
+        else if (held_us(f, t) >= f->debounce_us) {
+            f->state = LANE_DOWN ;
+            settled(f, p) ;
+            *edge_time = f->since ;
+            return true ;
+        }
+        break ;
+    case LANE_DOWN:
+        if (f->y <= p->release_level) {
+            f->state = LANE_RELEASE_PENDING ;
+            f->since = t ;
+        }
+        break ;
+    case LANE_RELEASE_PENDING:
+        if (f->y > p->release_level) {
+            f->state = LANE_DOWN ;
+            bounced(f, p) ;
+        }
+        else if (held_us(f, t) >= f->debounce_us) {
+            f->state = LANE_UP ;
+            settled(f, p) ;
+            *edge_time = f->since ;
+            return true ;
+        }
+        break ;
+    }
+    return false ;
+}
+
+uint32_t input_filter_latency_us(const input_filter_params_t *p, uint32_t sample_us) {
+    fix15 y = 0 ;
+    uint32_t n = 0 ;
+    while (y < p->press_level) {
+        y += (int2fix15(1) - y) >> p->shift ;
+        n++ ;
+    }
+    return n * sample_us + p->debounce_min_us ;
+}
@@ -0,0 +1,71 @@
+/**
+ * Lane input filter: low pass, hysteresis and adaptive debounce
+ *
+ * Each lane's samples (0..1.0 in fix15: a bend, or a 0/1 pin level) go
+ * through a one-pole IIR low pass, y += (x - y) >> shift. The filtered
+ * level must cross press_level to start a press and fall to
+ * release_level to start a release, and the new state must then hold
+ * for the lane's debounce time before it is reported. A transition
+ * that falls back inside the debounce time counts as a bounce and
+ * doubles that lane's debounce time (up to debounce_max_us); every
+ * clean transition shrinks it back toward debounce_min_us.
+ *
+ * Reported edges carry the time the filtered level crossed the
+ * threshold, not the time the debounce expired.
+ *
+ * Hardware independent, so it also builds on the host.
+ *
+ */
+#ifndef INPUT_FILTER_H
+#define INPUT_FILTER_H
+
+#include "pico/stdlib.h"
+#include "fix15.h"
+
+// Filter presets, from most responsive to most noise tolerant
+#define FILTER_FAST         0
+#define FILTER_BALANCED     1
+#define FILTER_SMOOTH       2
+#define NUM_FILTER_PRESETS  3
+
+typedef struct {
+    const char *name ;
+    uint8_t shift ;             // IIR coefficient is 1/2^shift (0 = off)
+    fix15 press_level ;
+    fix15 release_level ;       // below press_level
+    uint32_t debounce_min_us ;
+    uint32_t debounce_max_us ;
+} input_filter_params_t ;
+
+extern const input_filter_params_t input_filter_presets[NUM_FILTER_PRESETS] ;
+
+// Debounce states
+#define LANE_UP             0
+#define LANE_PRESS_PENDING  1
+#define LANE_DOWN           2
+#define LANE_RELEASE_PENDING 3
+
+typedef struct {
+    fix15 y ;                   // filtered level
+    uint32_t debounce_us ;      // current (adapted) debounce time
+    uint64_t since ;            // when the pending transition started
+    uint32_t bounces ;          // aborted transitions, for tuning
+    uint8_t state ;
+} lane_filter_t ;
+
+// Reset a lane to released, at the preset's minimum debounce
+void lane_filter_init(lane_filter_t *f, const input_filter_params_t *p) ;
+// Feed one sample taken at time t. Returns true when the debounced
+// state changes; *edge_time is then when the threshold was crossed.
+bool lane_filter_update(lane_filter_t *f, const input_filter_params_t *p,
+                        fix15 x, uint64_t t, uint64_t *edge_time) ;
+// Debounced state
+static inline bool lane_filter_down(const lane_filter_t *f) {
+    return f->state == LANE_DOWN || f->state == LANE_RELEASE_PENDING ;
+}
+// Added latency from a clean press to its report: samples for the
+// filtered level to reach press_level after a full step, plus the
+// minimum debounce time
+uint32_t input_filter_latency_us(const input_filter_params_t *p, uint32_t sample_us) ;
+
+#endif
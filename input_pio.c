@@ -0,0 +1,145 @@
+/**
+ * PIO sampling of the lane select lines
+ *
+ * Each group of consecutive select lines has its own state machine and
+ * change ring: player 1's four lines, and player 2's two pairs. A ring works
+ * like the ADC sample ring: its change channel is paced by the state
+ * machine's RX FIFO and wraps its writes with the DMA address ring, and
+ * its control channel rewrites the transfer count so it never stops.
+ *
+ * The sampler's counter starts at zero when the state machine is
+ * enabled and counts down once per sample, so sample n carries -n in 28
+ * bits. It wraps every 2^28 samples (about 45 minutes); the full count
+ * is recovered from the µs timer, which runs off the same crystal.
+ *
+ */
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "input.h"
+#include "input_pio.h"
+#include "lanes.pio.h"
+
+#define PIO_RING_BITS       10                          // 1 kByte
+#define PIO_RING_WORDS      ((1 << PIO_RING_BITS) / 4)
+#define PIO_RING_MASK       (PIO_RING_WORDS - 1)
+#define PIO_COUNT_BITS      28
+#define PIO_COUNT_MASK      ((1u << PIO_COUNT_BITS) - 1)
+
+// one sampler per group of consecutive select lines: the lanes they
+// drive, state machine, DMA channels and change ring. A state machine
+// always reads four pins; those past the group are ignored.
+typedef struct {
+    uint sm ;
+    uint pin ;
+    uint first_lane ;
+    uint lanes ;
+    uint dma_chan ;
+    uint ctrl_chan ;
+    uint32_t read_index ;
+} sampler_t ;
+
+#define NUM_SAMPLERS 3
+static PIO sampler_pio ;
+static sampler_t samplers[NUM_SAMPLERS] = {
+    { 0, SELECT_LINE_A, 0, LANES_PER_PLAYER, 6, 7 },
+    { 1, SELECT2_LINE_A, LANES_PER_PLAYER, 2, 8, 9 },
+    { 2, SELECT2_LINE_C, LANES_PER_PLAYER + 2, 2, 10, 11 },
+} ;
+
+static uint32_t pio_ring[NUM_SAMPLERS][PIO_RING_WORDS] __attribute__((aligned(1 << PIO_RING_BITS))) ;
+// reloaded into the change channels by the control channels
+static uint32_t pio_ring_transfers = PIO_RING_WORDS ;
+static uint64_t start_us ;
+
+static void sampler_start(sampler_t *s, uint32_t *ring, uint offset, float clkdiv) {
+    pio_sm_claim(sampler_pio, s->sm) ;
+    lane_sampler_program_init(sampler_pio, s->sm, offset, s->pin, clkdiv) ;
+
+    dma_channel_claim(s->dma_chan) ;
+    dma_channel_claim(s->ctrl_chan) ;
+
+    // Change channel (RX FIFO into the change ring)
+    dma_channel_config change = dma_channel_get_default_config(s->dma_chan) ;
+    channel_config_set_transfer_data_size(&change, DMA_SIZE_32) ;
+    channel_config_set_read_increment(&change, false) ;
+    channel_config_set_write_increment(&change, true) ;
+    channel_config_set_ring(&change, true, PIO_RING_BITS) ;             // wrap writes
+    channel_config_set_dreq(&change, pio_get_dreq(sampler_pio, s->sm, false)) ;
+    channel_config_set_chain_to(&change, s->ctrl_chan) ;
+
+    dma_channel_configure(
+        s->dma_chan,
+        &change,
+        ring,                               // write address (change ring)
+        &sampler_pio->rxf[s->sm],           // read address (RX FIFO)
+        PIO_RING_WORDS,
+        false
+    ) ;
+
+    // Control channel (restarts the change channel)
+    dma_channel_config ctrl = dma_channel_get_default_config(s->ctrl_chan) ;
+    channel_config_set_transfer_data_size(&ctrl, DMA_SIZE_32) ;
+    channel_config_set_read_increment(&ctrl, false) ;
+    channel_config_set_write_increment(&ctrl, false) ;
+
+    dma_channel_configure(
+        s->ctrl_chan,
+        &ctrl,
+        &dma_hw->ch[s->dma_chan].al1_transfer_count_trig,
+        &pio_ring_transfers,
+        1,
+        false
+    ) ;
+
+    s->read_index = 0 ;
+    dma_start_channel_mask(1u << s->dma_chan) ;
+}
+
+void pio_input_start() {
+    sampler_pio = pio1 ;
+    uint offset = pio_add_program(sampler_pio, &lane_sampler_program) ;
+    float clkdiv = (float)clock_get_hz(clk_sys) / (PIO_SAMPLE_RATE * LANE_SAMPLER_CYCLES) ;
+    uint32_t mask = 0 ;
+    for (uint i = 0; i < NUM_SAMPLERS; i++) {
+        sampler_start(&samplers[i], pio_ring[i], offset, clkdiv) ;
+        mask |= 1u << samplers[i].sm ;
+    }
+    // the counters of every sampler start on the same sample
+    start_us = time_us_64() ;
+    pio_enable_sm_mask_in_sync(sampler_pio, mask) ;
+}
+
+static uint32_t write_index(const sampler_t *s, const uint32_t *ring) {
+    return ((dma_hw->ch[s->dma_chan].write_addr - (uint32_t)(uintptr_t)ring) / 4) & PIO_RING_MASK ;
+}
+
+void pio_input_process() {
+    uint32_t heads[NUM_SAMPLERS] ;
+    for (uint i = 0; i < NUM_SAMPLERS; i++) heads[i] = write_index(&samplers[i], pio_ring[i]) ;
+    // read after the heads, so the changes up to them are no newer than
+    // this sample (plus one for the rounding)
+    uint64_t now_n = (time_us_64() - start_us) / PIO_SAMPLE_US + 1 ;
+
+    for (uint i = 0; i < NUM_SAMPLERS; i++) {
+        sampler_t *s = &samplers[i] ;
+        uint32_t head = heads[i] ;
+        while (s->read_index != head) {
+            uint32_t word = pio_ring[i][s->read_index] ;
+            s->read_index = (s->read_index + 1) & PIO_RING_MASK ;
+
+            // latest sample number that matches the 28-bit count
+            uint32_t n28 = (0u - word) & PIO_COUNT_MASK ;
+            uint64_t n = now_n - (((uint32_t)now_n - n28) & PIO_COUNT_MASK) ;
+            uint64_t t = start_us + n * PIO_SAMPLE_US ;
+
+            uint32_t state = word >> PIO_COUNT_BITS ;
+            // a change of the pins past the group repeats the lanes'
+            // levels, which input_lane_level() drops
+            for (uint lane = 0; lane < s->lanes; lane++) {
+                input_lane_level(s->first_lane + lane, (state >> lane) & 1, t) ;
+            }
+        }
+    }
+}
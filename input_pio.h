@@ -0,0 +1,32 @@
+/**
+ * PIO sampling of the lane select lines
+ *
+ * A state machine per group of consecutive select lines (GPIO 10..13
+ * for player 1, 0..1 and 21..22 for player 2) samples them at
+ * PIO_SAMPLE_RATE, with no jitter
+ * and no CPU time, and reports only changes, each tagged with the
+ * number of the sample that saw it (lanes.pio). A DMA channel moves the
+ * change words from the RX FIFO into a ring in SRAM; pio_input_process()
+ * turns the words it finds there into lane changes stamped to within
+ * one sample period.
+ *
+ * RESOURCES USED
+ *  - pio1 state machines 0, 1 and 2 (pio0 runs the VGA driver)
+ *  - DMA channels 6, 8 and 10 (change words), 7, 9 and 11 (restart them)
+ *  - 3 kBytes of RAM for the change rings
+ *
+ */
+#ifndef INPUT_PIO_H
+#define INPUT_PIO_H
+
+#include "pico/stdlib.h"
+
+#define PIO_SAMPLE_RATE     100000
+#define PIO_SAMPLE_US       (1000000/PIO_SAMPLE_RATE)
+
+// Load the sampler and start it and the DMA ring
+void pio_input_start(void) ;
+// Queue the changes captured since the last call as lane levels
+void pio_input_process(void) ;
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * Recording and replay streams of lane events
+ *
+ */
+#include <stdio.h>
+#include "input_record.h"
+
+static uint8_t record_buf[INPUT_RECORD_BYTES] ;
+static uint32_t record_len ;
+static uint32_t record_lost ;
+static uint64_t record_last_us ;
+static bool record_on ;
+
+uint32_t input_stream_encode(uint8_t *out, uint32_t room, uint64_t gap_us,
+                             uint8_t lane, uint8_t edge) {
+    uint64_t v = (gap_us << 4) | ((uint64_t)(edge & 1) << 3) | (lane & 7) ;
+    uint32_t n = 0 ;
+    do {
+        if (n == room) return 0 ;
+        uint8_t byte = v & 0x7f ;
+        v >>= 7 ;
+        out[n++] = v ? byte | 0x80 : byte ;
+    } while (v) ;
+    return n ;
+}
+
+void input_stream_init(input_stream_t *s, const uint8_t *data, uint32_t len) {
+    s->data = data ;
+    s->len = len ;
+    s->pos = 0 ;
+    s->time_us = 0 ;
+}
+
+bool input_stream_next(input_stream_t *s, input_event_t *event) {
+    uint64_t v = 0 ;
+    uint shift = 0 ;
+    uint8_t byte ;
+    do {
+        // a truncated varint ends the stream too
+        if (s->pos == s->len || shift > 63) return false ;
+        byte = s->data[s->pos++] ;
+        v |= (uint64_t)(byte & 0x7f) << shift ;
+        shift += 7 ;
+    } while (byte & 0x80) ;
+
+    s->time_us += v >> 4 ;
+    event->time_us = s->time_us ;
+    event->lane = v & 7 ;
+    event->edge = (v >> 3) & 1 ;
+    return true ;
+}
+
+void input_record_start(uint64_t start_us) {
+    record_len = 0 ;
+    record_lost = 0 ;
+    record_last_us = start_us ;
+    record_on = true ;
+}
+
+void input_record_stop() {
+    record_on = false ;
+}
+
+bool input_recording() {
+    return record_on ;
+}
+
+void input_record_event(const input_event_t *e) {
+    if (!record_on) return ;
+    // events are queued in time order, except that an edge can be older
+    // than one already recorded from another lane's filter
+    uint64_t gap = e->time_us > record_last_us ? e->time_us - record_last_us : 0 ;
+    uint32_t n = input_stream_encode(record_buf + record_len,
+        INPUT_RECORD_BYTES - record_len, gap, e->lane, e->edge) ;
+    if (n == 0) {
+        record_lost++ ;
+        return ;
+    }
+    record_len += n ;
+    record_last_us += gap ;
+}
+
+const uint8_t *input_record_data(uint32_t *len) {
+    *len = record_len ;
+    return record_buf ;
+}
+
+uint32_t input_record_dropped() {
+    return record_lost ;
+}
+
+void input_record_dump() {
+    for (uint32_t i = 0; i < record_len; i += 32) {
+        printf("REC ") ;
+        for (uint32_t j = i; j < i + 32 && j < record_len; j++) printf("%02x", record_buf[j]) ;
+        printf("\n") ;
+    }
+    printf("REC END %u bytes %u dropped\n", (unsigned)record_len, (unsigned)record_lost) ;
+}
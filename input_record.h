@@ -0,0 +1,52 @@
+/**
+ * Recording and replay streams of lane events
+ *
+ * While recording, every event handed to the game is appended to a RAM
+ * buffer as one LEB128 varint:
+ *     (µs since the previous event) << 4 | edge << 3 | lane
+ * which is 2 or 3 bytes for the gaps of a normal game. The buffer can
+ * be dumped over USB stdio as "REC" lines of hex (tools/input_log.py
+ * turns a captured log back into a binary stream) and fed back to the
+ * game with input_replay_start() (input.h).
+ *
+ * Hardware independent, so streams can be decoded on the host.
+ *
+ */
+#ifndef INPUT_RECORD_H
+#define INPUT_RECORD_H
+
+#include "pico/stdlib.h"
+#include "input.h"
+
+#define INPUT_RECORD_BYTES  8192
+
+// Reader over an encoded stream; event times are µs from its start
+typedef struct {
+    const uint8_t *data ;
+    uint32_t len ;
+    uint32_t pos ;
+    uint64_t time_us ;
+} input_stream_t ;
+
+// Start a new recording; event times are taken relative to start_us
+void input_record_start(uint64_t start_us) ;
+void input_record_stop(void) ;
+bool input_recording(void) ;
+// Append an event (called for every event queued for the game)
+void input_record_event(const input_event_t *event) ;
+// The recording so far
+const uint8_t *input_record_data(uint32_t *len) ;
+// Events that did not fit in the buffer
+uint32_t input_record_dropped(void) ;
+// Print the recording as "REC <hex>" lines and a closing "REC END"
+void input_record_dump(void) ;
+
+// Encode one event with its gap to the previous one; returns the bytes
+// written, 0 if they do not fit in room
+uint32_t input_stream_encode(uint8_t *out, uint32_t room, uint64_t gap_us,
+                             uint8_t lane, uint8_t edge) ;
+void input_stream_init(input_stream_t *s, const uint8_t *data, uint32_t len) ;
+// Decode the next event; false at the end of the stream
+bool input_stream_next(input_stream_t *s, input_event_t *event) ;
+
+#endif
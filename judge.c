@@ -0,0 +1,130 @@
+/**
+ * Hit judgment for the piano tiles game
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include "judge.h"
+
+const judge_windows_t judge_default_windows = { 33000, 66000, 100000 } ;
+
+static const uint32_t JUDGE_POINTS[NUM_GRADES] = { 300, 200, 100, 0 } ;
+static const char *const grade_names[NUM_GRADES] = { "perfect", "great", "good", "miss" } ;
+
+// the combo multiplies the points by 1 + combo/16, up to 4x
+#define COMBO_STEP  16
+#define COMBO_MAX   (3*COMBO_STEP)
+
+void judge_init(judge_t *j, const judge_windows_t *windows) {
+    memset(j, 0, sizeof(*j)) ;
+    j->windows = *windows ;
+}
+
+int judge_grade(const judge_windows_t *w, int32_t offset_us) {
+    uint32_t d = offset_us < 0 ? -offset_us : offset_us ;
+    if (d <= w->perfect_us) return JUDGE_PERFECT ;
+    if (d <= w->great_us) return JUDGE_GREAT ;
+    if (d <= w->good_us) return JUDGE_GOOD ;
+    return JUDGE_MISS ;
+}
+
+static int award(judge_t *j, uint lane, int32_t offset_us) {
+    int grade = judge_grade(&j->windows, offset_us) ;
+    judge_lane_stats_t *s = &j->lane[lane] ;
+    s->grades[grade]++ ;
+    s->hits++ ;
+    s->offset_sum_us += offset_us ;
+    s->abs_offset_sum_us += offset_us < 0 ? -offset_us : offset_us ;
+
+    uint32_t combo = j->combo < COMBO_MAX ? j->combo : COMBO_MAX ;
+    j->score += JUDGE_POINTS[grade] * (COMBO_STEP + combo) / COMBO_STEP ;
+    j->combo++ ;
+    if (j->combo > j->max_combo) j->max_combo = j->combo ;
+    return grade ;
+}
+
+// offset of a press from an arrival, if it lies within the good window
+static bool in_window(const judge_t *j, uint64_t press, uint64_t arrival, int32_t *offset_us) {
+    int64_t d = (int64_t)(press - arrival) ;
+    if (d < -(int64_t)j->windows.good_us || d > (int64_t)j->windows.good_us) return false ;
+    *offset_us = (int32_t)d ;
+    return true ;
+}
+
+static void miss(judge_t *j, uint lane) {
+    j->lane[lane].grades[JUDGE_MISS]++ ;
+    j->combo = 0 ;
+}
+
+int judge_tile(judge_t *j, uint lane, uint64_t arrival_us) {
+    uint64_t press = j->early_press[lane] ;
+    int32_t offset ;
+    j->early_press[lane] = 0 ;
+    if (press && in_window(j, press, arrival_us, &offset)) {
+        return award(j, lane, offset) ;
+    }
+
+    uint8_t head = j->pending_head[lane] ;
+    if ((uint8_t)(head - j->pending_tail[lane]) == JUDGE_PENDING) {
+        // no room: the oldest tile is lost
+        miss(j, lane) ;
+        j->pending_tail[lane]++ ;
+    }
+    j->pending[lane][head & (JUDGE_PENDING - 1)] = arrival_us ;
+    j->pending_head[lane] = head + 1 ;
+    return JUDGE_NONE ;
+}
+
+int judge_press(judge_t *j, uint lane, uint64_t time_us) {
+    uint8_t tail = j->pending_tail[lane] ;
+    if (tail != j->pending_head[lane]) {
+        uint64_t arrival = j->pending[lane][tail & (JUDGE_PENDING - 1)] ;
+        int32_t offset ;
+        if (in_window(j, time_us, arrival, &offset)) {
+            j->pending_tail[lane] = tail + 1 ;
+            return award(j, lane, offset) ;
+        }
+    }
+    // keep it for the next tile; a later press replaces it
+    j->early_press[lane] = time_us ;
+    return JUDGE_NONE ;
+}
+
+uint32_t judge_expire(judge_t *j, uint64_t now) {
+    uint32_t missed = 0 ;
+    for (uint lane = 0; lane < JUDGE_MAX_LANES; lane++) {
+        while (j->pending_tail[lane] != j->pending_head[lane]) {
+            uint64_t arrival = j->pending[lane][j->pending_tail[lane] & (JUDGE_PENDING - 1)] ;
+            if (now <= arrival + j->windows.good_us) break ;
+            j->pending_tail[lane]++ ;
+            miss(j, lane) ;
+            missed |= 1u << lane ;
+        }
+    }
+    return missed ;
+}
+
+void judge_shift(judge_t *j, uint64_t dt_us) {
+    for (uint lane = 0; lane < JUDGE_MAX_LANES; lane++) {
+        for (uint i = 0; i < JUDGE_PENDING; i++) j->pending[lane][i] += dt_us ;
+        if (j->early_press[lane]) j->early_press[lane] += dt_us ;
+    }
+}
+
+const char *judge_grade_name(int grade) {
+    return grade_names[grade] ;
+}
+
+void judge_print(const judge_t *j, uint lanes) {
+    printf("score %u  max combo %u\n", (unsigned)j->score, (unsigned)j->max_combo) ;
+    for (uint lane = 0; lane < lanes && lane < JUDGE_MAX_LANES; lane++) {
+        const judge_lane_stats_t *s = &j->lane[lane] ;
+        printf("lane %u:", lane + 1) ;
+        for (int g = 0; g < NUM_GRADES; g++) printf(" %s %u", grade_names[g], (unsigned)s->grades[g]) ;
+        if (s->hits) {
+            printf("  mean %+d us  mean abs %u us",
+                (int)(s->offset_sum_us / (int64_t)s->hits), (unsigned)(s->abs_offset_sum_us / s->hits)) ;
+        }
+        printf("\n") ;
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * Hit judgment for the piano tiles game
+ *
+ * Judges each tile by how far the press that hit it was from the tile's
+ * arrival at the hit line, using the µs timestamps of the input events,
+ * so the grade does not depend on where in the game loop the press
+ * fell. Presses up to the good window before a tile arrives are kept,
+ * and a tile waits the good window after its arrival for a late press
+ * before it counts as missed.
+ *
+ * Grades score JUDGE_POINTS, scaled by the combo of consecutive hits.
+ * Integer only; hardware independent.
+ *
+ */
+#ifndef JUDGE_H
+#define JUDGE_H
+
+#include "pico/stdlib.h"
+
+#define JUDGE_MAX_LANES     8
+#define JUDGE_PENDING       4       // tiles awaiting judgment per lane, power of two
+
+// Grades
+#define JUDGE_PERFECT       0
+#define JUDGE_GREAT         1
+#define JUDGE_GOOD          2
+#define JUDGE_MISS          3
+#define NUM_GRADES          4
+#define JUDGE_NONE          -1
+
+// Half widths of the windows around the arrival time, µs
+typedef struct {
+    uint32_t perfect_us ;
+    uint32_t great_us ;
+    uint32_t good_us ;
+} judge_windows_t ;
+
+extern const judge_windows_t judge_default_windows ;
+
+typedef struct {
+    uint32_t grades[NUM_GRADES] ;
+    int64_t offset_sum_us ;     // signed: negative means early on average
+    uint64_t abs_offset_sum_us ;
+    uint32_t hits ;             // graded presses, the count for both sums
+} judge_lane_stats_t ;
+
+typedef struct {
+    judge_windows_t windows ;
+    uint32_t score ;
+    uint32_t combo ;
+    uint32_t max_combo ;
+    judge_lane_stats_t lane[JUDGE_MAX_LANES] ;
+    // private
+    uint64_t pending[JUDGE_MAX_LANES][JUDGE_PENDING] ;  // arrival times
+    uint8_t pending_head[JUDGE_MAX_LANES] ;
+    uint8_t pending_tail[JUDGE_MAX_LANES] ;
+    uint64_t early_press[JUDGE_MAX_LANES] ;             // unused press, or 0
+} judge_t ;
+
+void judge_init(judge_t *j, const judge_windows_t *windows) ;
+// A tile of the lane reaches the hit line at arrival_us. Returns its
+// grade if an earlier press already hit it, else JUDGE_NONE.
+int judge_tile(judge_t *j, uint lane, uint64_t arrival_us) ;
+// A press of the lane at time_us. Returns the grade of the tile it hit,
+// or JUDGE_NONE if it is kept for a tile still to come (or ignored).
+int judge_press(judge_t *j, uint lane, uint64_t time_us) ;
+// Judge as missed every tile whose late window closed before now.
+// Returns the bitmask of lanes that missed.
+uint32_t judge_expire(judge_t *j, uint64_t now) ;
+// Move every pending arrival and kept press dt_us later, after the
+// game was paused for dt_us
+void judge_shift(judge_t *j, uint64_t dt_us) ;
+// Grade of a press offset_us from the arrival (JUDGE_MISS outside)
+int judge_grade(const judge_windows_t *w, int32_t offset_us) ;
+const char *judge_grade_name(int grade) ;
+// Per-lane accuracy over USB stdio
+void judge_print(const judge_t *j, uint lanes) ;
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * Input-to-photon and input-to-sound latency tracing
+ *
+ * The photon time assumes the frame buffer write becomes visible the
+ * next time the scanout reaches its first line. vga_scanline() reads 0
+ * during vertical blanking, so a write then is reported up to the
+ * 45-line blank (1.4 ms) early.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "vga_graphics.h"
+#include "audio.h"
+#include "latency.h"
+
+// a note that has not started by then was never played (no song)
+#define SOUND_TIMEOUT_US    500000
+
+static latency_hist_t hist[NUM_LATENCY_SPANS] ;
+static const char *const span_names[NUM_LATENCY_SPANS] = { "framebuffer", "photon", "sound" } ;
+
+static bool sound_pending ;
+static uint32_t sound_input_us ;
+static uint32_t sound_notes ;
+
+void latency_reset() {
+    memset(hist, 0, sizeof(hist)) ;
+    sound_pending = false ;
+}
+
+void latency_add(int span, uint32_t us) {
+    latency_hist_t *h = &hist[span] ;
+    uint32_t bin = us / LATENCY_BIN_US ;
+    h->bins[bin < LATENCY_BINS ? bin : LATENCY_BINS]++ ;
+    h->count++ ;
+    h->sum_us += us ;
+    if (us > h->max_us) h->max_us = us ;
+}
+
+void latency_frame_written(uint32_t input_us, short y) {
+    uint32_t now = time_us_32() ;
+    uint32_t lines = (y - vga_scanline() + VGA_FRAME_LINES) % VGA_FRAME_LINES ;
+    latency_add(LATENCY_FRAMEBUFFER, now - input_us) ;
+    latency_add(LATENCY_PHOTON, now + lines*VGA_LINE_US - input_us) ;
+}
+
+void latency_sound_requested(uint32_t input_us) {
+    // one trace at a time; a second hit before the first note started
+    // would be matched to the wrong note
+    if (sound_pending) return ;
+    sound_pending = true ;
+    sound_input_us = input_us ;
+    sound_notes = audio_notes_started ;
+}
+
+void latency_poll() {
+    if (!sound_pending) return ;
+    if (audio_notes_started != sound_notes) {
+        // the count is written after the time
+        __dmb() ;
+        latency_add(LATENCY_SOUND, audio_note_start_us - sound_input_us) ;
+        sound_pending = false ;
+    }
+    else if (time_us_32() - sound_input_us > SOUND_TIMEOUT_US) {
+        sound_pending = false ;
+    }
+}
+
+// smallest bin edge with at least per_mille of the samples below it
+static uint32_t percentile(const latency_hist_t *h, uint32_t per_mille) {
+    uint32_t need = (h->count * per_mille + 999) / 1000, seen = 0 ;
+    for (uint32_t bin = 0; bin <= LATENCY_BINS; bin++) {
+        seen += h->bins[bin] ;
+        if (seen >= need) return (bin + 1) * LATENCY_BIN_US ;
+    }
+    return h->max_us ;
+}
+
+void latency_print() {
+    for (int span = 0; span < NUM_LATENCY_SPANS; span++) {
+        const latency_hist_t *h = &hist[span] ;
+        if (h->count == 0) continue ;
+        printf("LAT %s n %u mean %u p50 %u p90 %u p99 %u max %u\n", span_names[span],
+            (unsigned)h->count, (unsigned)(h->sum_us / h->count),
+            (unsigned)percentile(h, 500), (unsigned)percentile(h, 900),
+            (unsigned)percentile(h, 990), (unsigned)h->max_us) ;
+        // bins up to the last non-empty one
+        uint32_t last = LATENCY_BINS ;
+        while (last > 0 && h->bins[last] == 0) last-- ;
+        printf("HIST %s %u %u", span_names[span], LATENCY_BIN_US, LATENCY_BINS) ;
+        for (uint32_t bin = 0; bin <= last; bin++) printf(" %u", (unsigned)h->bins[bin]) ;
+        printf("\n") ;
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * Input-to-photon and input-to-sound latency tracing
+ *
+ * Each tile hit is traced from the timestamp of the press that caused
+ * it to:
+ *  - the hit flash written into the frame buffer (input to frame buffer)
+ *  - the next scanout of the first line of that write, from the pixel
+ *    DMA position and the VGA line time (input to photon)
+ *  - the first DAC sample of the hit's melody note, stamped by the
+ *    audio ISR (input to sound)
+ * Each span is kept as a histogram of LATENCY_BIN_US bins and printed
+ * over USB stdio as LAT (summary) and HIST (bins) lines, which
+ * tools/latency_report.py reads back:
+ *   HIST <span> <bin µs> <bins> <count of bin 0> <count of bin 1> ...
+ * where bin <bins> counts everything longer and trailing empty bins are
+ * left out.
+ *
+ * All times are time_us_32().
+ *
+ */
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "pico/stdlib.h"
+
+// 0 compiles the tracing out of the game loop
+#ifndef LATENCY_TRACE
+#define LATENCY_TRACE 1
+#endif
+
+#define LATENCY_BIN_US      1000
+#define LATENCY_BINS        128     // plus one for everything longer
+
+// Spans
+#define LATENCY_FRAMEBUFFER 0
+#define LATENCY_PHOTON      1
+#define LATENCY_SOUND       2
+#define NUM_LATENCY_SPANS   3
+
+typedef struct {
+    uint32_t bins[LATENCY_BINS + 1] ;
+    uint32_t count ;
+    uint64_t sum_us ;
+    uint32_t max_us ;
+} latency_hist_t ;
+
+void latency_reset(void) ;
+void latency_add(int span, uint32_t us) ;
+// The reaction to the press at input_us has just been drawn into the
+// frame buffer, starting at line y
+void latency_frame_written(uint32_t input_us, short y) ;
+// The reaction's note was just requested with audio_play()
+void latency_sound_requested(uint32_t input_us) ;
+// Pick up the start of a requested note (call once per loop)
+void latency_poll(void) ;
+// Summary and histogram of every span
+void latency_print(void) ;
+
+#endif
@@ -22,17 +22,21 @@
  *  - GPIO 14-B mux
  * GPIO 13-C mux
  * gpio26/ADC0- comout mux
+ * GPIO 0, 1, 21, 22 - player 2 select lines (versus mode, input.h)
  *1
  *
  * RESOURCES USED
  *  - PIO state machines 0, 1, and 2 on PIO instance 0
  *  - DMA channels 0 and 1
  *  - 153.6 kBytes of RAM (for pixel color data)
+ *  - Core 1 and hardware alarm 2 for the 40 kHz audio ISR (AUDIO_ON_CORE1)
+ *  - Core 1 also draws player 2's half of the versus screen (RENDER_ON_CORE1)
  *
  */
 #include "vga_graphics.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
 #include "hardware/pio.h"
@@ -42,6 +46,15 @@
 #include "math.h"
 #include "hardware/spi.h"
 #include "hardware/sync.h"
+#include "fix15.h"
+#include "audio.h"
+#include "input.h"
+#include "input_adc.h"
+#include "input_record.h"
+#include "latency.h"
+#include "game.h"
+#include "tempo.h"
+#include "effects.h"
 // Include protothreads
 #include "pt_cornell_rp2040_v1.h"
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -60,622 +73,897 @@ typedef signed int fix28 ;
 int previous_sound=0;
 // Maximum number of iterations
 #define max_count 1000
-int input_flex1=0;
-int input_flex2=0;
-int input_flex3=0;
-int input_flex4=0;
-#define LEFT_VERT 150
-#define MID_VERT 240
-#define RIGHT_VERT 420
-#define THIRD_VERT 330
-float speed_fact=2;
-#define LEFT_VERT_TILES 160
-#define MID_VERT_TILES 250
-#define THIRD_VERT_TILES 340
-#define RIGHT_VERT_TILES 430
-#define SELECT_LINE_A 10
-#define SELECT_LINE_B 11
-#define SELECT_LINE_C 12
-#define SELECT_LINE_D 13
 #define RESTART_PIN 4
+// INPUT_GPIO_IRQ or INPUT_PIO for the comparator select lines,
+// INPUT_ADC_DMA to read the flex sensors directly
+#define INPUT_BACKEND INPUT_GPIO_IRQ
+// FILTER_FAST, FILTER_BALANCED or FILTER_SMOOTH (input_filter.h)
+#define INPUT_FILTER FILTER_BALANCED
+// SESSION_LIVE: just play. SESSION_RECORD: record the lane events of
+// every game and dump them over USB at game over. SESSION_REPLAY: record
+// the first game, then replay it in every following game, so scores and
+// timing can be compared across builds.
+#define SESSION_LIVE   0
+#define SESSION_RECORD 1
+#define SESSION_REPLAY 2
+#define INPUT_SESSION SESSION_LIVE
 #define RESTART_PIN_REG ((volatile uint32_t *)(IO_BANK0_BASE + 0x010))
 uint adc_x_raw;
 //***************************************************************************************
-typedef signed int fix15 ;
-#define multfix15(a,b) ((fix15)((((signed long long)(a))*((signed long long)(b)))>>15))
-#define float2fix15(a) ((fix15)((a)*32768.0)) 
-#define fix2float15(a) ((float)(a)/32768.0)
-#define absfix15(a) abs(a) 
-#define int2fix15(a) ((fix15)(a << 15))
-#define fix2int15(a) ((int)(a >> 15))
-#define char2fix15(a) (fix15)(((fix15)(a)) << 15)
-#define divfix(a,b) (fix15)( (((signed long long)(a)) << 15) / (b))
-
-//Direct Digital Synthesis (DDS) parameters
-#define two32 4294967296.0  // 2^32 (a constant)
-#define Fs 40000            // sample rate
-
-// the DDS units - core 0
-// Phase accumulator and phase increment. Increment sets output frequency.
-volatile unsigned int phase_accum_main_0;
-volatile unsigned int phase_incr_main_0 = (400.0*two32)/Fs ;
-
-// DDS sine table (populated in main())
-#define sine_table_size 256
-fix15 sin_table[sine_table_size] ;
-
-// Values output to DAC
-int DAC_output_0 ;
-int DAC_output_1 ;
-
-// Amplitude modulation parameters and variables
-fix15 max_amplitude = int2fix15(1) ;    // maximum amplitude
-fix15 attack_inc ;                      // rate at which sound ramps up
-fix15 decay_inc ;                       // rate at which sound ramps down
-fix15 current_amplitude_0 = 0 ;         // current amplitude (modified in ISR)
-fix15 current_amplitude_1 = 0 ;         // current amplitude (modified in ISR)
-
-// Timing parameters for beeps (units of interrupts)
-#define ATTACK_TIME             200
-#define DECAY_TIME              200
-#define SUSTAIN_TIME            10000
-#define BEEP_DURATION           5200
-#define BEEP_REPEAT_INTERVAL    40000
-
-// State machine variables
-volatile unsigned int STATE_0 = 0 ;
-volatile unsigned int count_0 = 0 ;
-
-// SPI data
-uint16_t DAC_data_1 ; // output value
-uint16_t DAC_data_0 ; // output value
-
-// DAC parameters (see the DAC datasheet)
-// A-channel, 1x, active
-#define DAC_config_chan_A 0b0011000000000000
-// B-channel, 1x, active
-#define DAC_config_chan_B 0b1011000000000000
-
-//SPI configurations (note these represent GPIO number, NOT pin number)
-#define PIN_MISO 4
-#define PIN_CS   5
-#define PIN_SCK  6
-#define PIN_MOSI 7
-#define LDAC     8
-#define LED      25
-#define ISR      15
-#define SPI_PORT spi0
-
-// Two variables to store core number
-volatile int corenum_0  ;
-
-// Global counter for spinlock experimenting
-volatile int global_counter = 0 ;
-//***********
-int flag=0;
-
-
-
-//**********************************
-//***********************************************************sound
-
-// This timer ISR is called on core 0
-bool repeating_timer_callback_core_0(struct repeating_timer *t) {
-    
-
-    if (STATE_0 == 1) {
-        // DDS phase and sine table lookup
-        gpio_put(ISR, 1) ;
-        float y;
-        y=-260*sin(-1*3.141592*count_0/5200)+1740;
-        volatile unsigned int phase_incr_main_3=y*(two32)/Fs;
-        phase_accum_main_0 += phase_incr_main_3  ;
-        DAC_output_0 = fix2int15(multfix15(current_amplitude_0,
-            sin_table[phase_accum_main_0>>24])) + 2048 ;
-
-        // Ramp up amplitude
-        if (count_0 < ATTACK_TIME) {
-            current_amplitude_0 = (current_amplitude_0 + attack_inc) ;
-        }
-        // Ramp down amplitude
-        else if (count_0 > BEEP_DURATION - DECAY_TIME) {
-            current_amplitude_0 = (current_amplitude_0 - decay_inc) ;
-        }
-
-        // Mask with DAC control bits
-        DAC_data_0 = (DAC_config_chan_B | (DAC_output_0 & 0xffff))  ;
 
-        // SPI write (no spinlock b/c of SPI buffer)
-        spi_write16_blocking(SPI_PORT, &DAC_data_0, 1) ;
 
-        // Increment the counter
-        count_0 += 1 ;
-
-        // State transition?
-        if (count_0 == BEEP_DURATION) {
-            STATE_0 = 0 ;
-            count_0 = 0 ;
-            flag=0;
+// Playfield lanes of each player, left to right (4, 6 or 8)
+#define PLAYFIELD_LANES 4
+#define LANE_BIT(lane) (1u << (lane))
+// Versus mode: player 1's playfield on the left, player 2's on the
+// right, and the scores in a column between them. The split is on even
+// pixels, so the two halves never share a frame buffer byte.
+#define VERSUS_FIELD_W  272
+#define VERSUS_HUD_X    VERSUS_FIELD_W
+#define VERSUS_RIGHT_X  (640 - VERSUS_FIELD_W)
+// 1 - in the versus mode core 1 draws player 2's half of each frame
+//     while core 0 draws player 1's
+// 0 - core 0 draws both halves, one after the other
+#define RENDER_ON_CORE1 1
+
+// A player: the game logic, and what is on the screen of its playfield
+typedef struct {
+    game_t game;                // tiles, judgment and score (game.h)
+    effects_t effects;          // hit and miss feedback in its playfield
+    uint32_t view_pos;          // scroll position the tiles are drawn at (16.16 px)
+    uint32_t lanes;             // playfield lanes pressed, for the indicators
+    uint32_t shown_lanes;       // indicators as drawn
+    uint32_t hit_lanes;         // hits not shown yet
+    uint64_t hit_input_us;      // press time of the first of them
+    bool playing;               // in the game; a miss takes a player out
+    uint shown_score;
+    uint32_t hit_steps;         // logic steps in which it hit, for the melody
+    // frame time and input latency since the last report
+    uint32_t frames;
+    uint32_t draw_us, draw_max_us;          // drawing its half of a frame
+    uint32_t hits_shown;
+    uint32_t input_us, input_max_us;        // press to hit flash in the frame buffer
+} player_t;
+
+player_t players[NUM_PLAYERS];
+uint num_players = 1;
+// Melody notes requested this game. There is one melody voice, which
+// follows the player furthest along: both players hitting the same
+// notes play each of them once.
+uint32_t melody_notes;
+// The game's clock, read from the song's samples (tempo.h)
+tempo_t tempo;
+
+// Lane indicators under a playfield. Only lanes whose state changed
+// since they were last drawn are repainted.
+void draw_lane_indicators(player_t *p) {
+    playfield_t *pf = &p->game.pf;
+    uint32_t changed = p->lanes ^ p->shown_lanes;
+    for (uint lane = 0; lane < pf->count; lane++) {
+        if (changed & LANE_BIT(lane)) {
+            fillRect(pf->indicator_x[lane], INDICATOR_Y, pf->indicator_w, INDICATOR_H, (p->lanes & LANE_BIT(lane)) ? WHITE : 0);
         }
-        gpio_put(ISR, 0) ;
-
     }
+    p->shown_lanes = p->lanes;
+}
 
-    else if (STATE_0 ==2)
-       {
-        // DDS phase and sine table lookup
-        gpio_put(ISR, 1) ;
-        float y;
-        y=0.000184*count_0*count_0 + 2000; 
-        volatile unsigned int phase_incr_main_2 = (y*two32)/Fs ;
-        phase_accum_main_0 += phase_incr_main_2  ;
-        DAC_output_0 = fix2int15(multfix15(current_amplitude_0,
-            sin_table[phase_accum_main_0>>24])) + 2048 ;
-
-        // Ramp up amplitude
-        if (count_0 < ATTACK_TIME) {
-            current_amplitude_0 = (current_amplitude_0 + attack_inc) ;
-        }
-        // Ramp down amplitude
-        else if (count_0 > BEEP_DURATION - DECAY_TIME) {
-            current_amplitude_0 = (current_amplitude_0 - decay_inc) ;
-        }
-
-        // Mask with DAC control bits
-        DAC_data_0 = (DAC_config_chan_B | (DAC_output_0 & 0xffff))  ;
-
-        // SPI write (no spinlock b/c of SPI buffer)
-        spi_write16_blocking(SPI_PORT, &DAC_data_0, 1) ;
-
-        // Increment the counter
-        count_0 += 1 ;
-
-        // State transition?
-        if (count_0 == BEEP_DURATION) {
-            STATE_0 = 0 ;
-            count_0 = 0 ;
-            flag=0;
+// Bitmask of the input lanes pressed (bit n = lane n). Lane events are
+// drained from the input ring, so a lane counts if it is down now or
+// was pressed at any time since the last call, even for less than one
+// loop. Any number of lanes can be down at once. Every press is handed
+// to the game of each player in play with its timestamp in music time,
+// to be judged; a game ignores the other player's glove. Each player's
+// pressed playfield lanes are left in its lanes.
+uint32_t act_adc(void) {
+    adc_x_raw = input_analog(0);
+    input_event_t event;
+    uint32_t inputs = 0;
+    input_poll();
+    while (input_get_event(&event)) {
+        if (event.edge != INPUT_PRESS) continue;
+        inputs |= LANE_BIT(event.lane);
+        for (uint pl = 0; pl < num_players; pl++) {
+            if (players[pl].playing) game_press(&players[pl].game, event.lane, tempo_from_wall(&tempo, event.time_us));
         }
-        gpio_put(ISR, 0) ;
     }
-
-
-else if (STATE_0 ==4)
-       {
-        
-
-        // Increment the counter
-        count_0 += 1 ;
-
-        // State transition?
-        if (count_0 == 1200) {
-            STATE_0 = 0 ;
-            count_0 = 0 ;
-            flag=0;
+    inputs |= input_lanes_down();
+    for (uint pl = 0; pl < num_players; pl++) {
+        players[pl].lanes = 0;
+        for (uint in = 0; in < NUM_LANES; in++) {
+            if (inputs & LANE_BIT(in)) players[pl].lanes |= players[pl].game.pf.input_lanes[in];
         }
     }
+    return inputs;
+}
 
-else if (STATE_0 ==5)
-       {
-        // DDS phase and sine table lookup
-        float y;
-        y=-0.5769*count_0+6000; 
-        volatile unsigned int phase_incr_main_5 = (y*two32)/Fs ;
-        phase_accum_main_0 += phase_incr_main_5  ;
-        DAC_output_0 = fix2int15(multfix15(current_amplitude_0,
-            sin_table[phase_accum_main_0>>24])) + 2048 ;
-
-        // Ramp up amplitude
-        if (count_0 < ATTACK_TIME) {
-            current_amplitude_0 = (current_amplitude_0 + attack_inc) ;
-        }
-        // Ramp down amplitude
-        else if (count_0 > BEEP_DURATION - DECAY_TIME) {
-            current_amplitude_0 = (current_amplitude_0 - decay_inc) ;
-        }
+// Game logic runs in fixed steps (game.h) when music time reaches them;
+// the screen is redrawn once after each batch of steps, as often as
+// drawing allows, with the tiles where they will be when the scanout
+// reaches the hit line. A frame drawn closer to that than this many
+// lines is seen a frame later.
+#define SCANOUT_MARGIN_LINES 32
+// hit and miss feedback (effects.h)
+#define HIT_FLASH_US    40000
+#define HIT_FADE_US     120000
+#define HIT_BURST_US    300000
+#define MISS_FLASH_US   150000
+#define MISS_FADE_US    400000
+#define FPS_REPORT_US   1000000
+
+// Music time at which the scanout next shows the hit line
+uint64_t scanout_time(uint64_t music_us) {
+    uint32_t lines = (ARRIVAL_Y - vga_scanline() + VGA_FRAME_LINES) % VGA_FRAME_LINES;
+    if (lines < SCANOUT_MARGIN_LINES) lines += VGA_FRAME_LINES;
+    return music_us + lines*VGA_LINE_US;
+}
 
-        // Mask with DAC control bits
-        DAC_data_0 = (DAC_config_chan_B | (DAC_output_0 & 0xffff))  ;
+// Move a player's view to the scroll position at a music time. It never
+// moves back, which the tile drawing does not handle.
+void update_view(player_t *p, uint64_t music_us) {
+    uint32_t pos = scroll_pos16(game_scroll_at_us(&p->game, music_us));
+    if ((int32_t)(pos - p->view_pos) > 0) p->view_pos = pos;
+}
 
-        // SPI write (no spinlock b/c of SPI buffer)
-        spi_write16_blocking(SPI_PORT, &DAC_data_0, 1) ;
+// Screen y of the top of a tile that arrives when the scroll reaches
+// pos (16.16 px); tiles fall from above the screen
+static inline short tile_y(const player_t *p, uint32_t pos) {
+    return ARRIVAL_Y - (short)((int32_t)(pos - p->view_pos) >> 16);
+}
 
-        // Increment the counter
-        count_0 += 1 ;
+// Fill rows [y0, y1) of a tile column, clipped to the playfield
+void fill_rows(short x, int y0, int y1, short w, char color){
+    if (y0 < 0) y0 = 0;
+    if (y1 > INDICATOR_Y) y1 = INDICATOR_Y;
+    if (y1 > y0) fillRect(x,y0,w,y1-y0,color);
+}
 
-        // State transition?
-        if (count_0 == BEEP_DURATION) {
-            STATE_0 = 0 ;
-            count_0 = 0 ;
-            flag=0;
-        }
+// Move a tile down from old_y to new_y, touching only the rows that
+// changed. Rows above clear_from belong to the next tile up the lane
+// and are not erased.
+void draw_tile(short x, short old_y, short new_y, short w, short h, char color, short clear_from){
+    if (old_y == TILE_HIDDEN) {
+        fill_rows(x,new_y,new_y+h,w,color);
+        return;
     }
+    if (new_y == old_y) return;
+    if (new_y - old_y >= h) {
+        fill_rows(x,MAX(old_y,clear_from),old_y+h,w,0);
+        fill_rows(x,new_y,new_y+h,w,color);
+        return;
+    }
+    fill_rows(x,MAX(old_y,clear_from),new_y,w,0);
+    fill_rows(x,old_y+h,new_y+h,w,color);
+}
 
-else if (STATE_0 ==6)
-       {
-        // DDS phase and sine table lookup
-        float y;
-        y=-0.192*count_0 + 3000; 
-        volatile unsigned int phase_incr_main_6 = (y*two32)/Fs ;
-        phase_accum_main_0 += phase_incr_main_6  ;
-        DAC_output_0 = fix2int15(multfix15(current_amplitude_0,
-            sin_table[phase_accum_main_0>>24])) + 2048 ;
-
-        // Ramp up amplitude
-        if (count_0 < ATTACK_TIME) {
-            current_amplitude_0 = (current_amplitude_0 + attack_inc) ;
-        }
-        // Ramp down amplitude
-        else if (count_0 > BEEP_DURATION - DECAY_TIME) {
-            current_amplitude_0 = (current_amplitude_0 - decay_inc) ;
-        }
-
-        // Mask with DAC control bits
-        DAC_data_0 = (DAC_config_chan_B | (DAC_output_0 & 0xffff))  ;
+// Bottom of the tile above the n-th oldest of a lane, as drawn
+short drawn_bottom_above(const playfield_t *pf, uint lane, uint n) {
+    if (n + 1 >= playfield_tiles(pf, lane)) return -TILE_H;
+    short y = pf->tile_drawn_y[lane][playfield_slot(pf, lane, n + 1)];
+    return y == TILE_HIDDEN ? -TILE_H : y + TILE_H;
+}
 
-        // SPI write (no spinlock b/c of SPI buffer)
-        spi_write16_blocking(SPI_PORT, &DAC_data_0, 1) ;
+// Take the oldest tile of a lane off the screen (the game's retire
+// hook; ctx is the player)
+void erase_oldest_tile(void *ctx, uint lane) {
+    const playfield_t *pf = &((player_t *)ctx)->game.pf;
+    short y = pf->tile_drawn_y[lane][playfield_slot(pf, lane, 0)];
+    if (y != TILE_HIDDEN) fill_rows(pf->tile_x[lane],MAX(y,drawn_bottom_above(pf, lane, 0)),y+TILE_H,pf->tile_w,0);
+}
 
-        // Increment the counter
-        count_0 += 1 ;
+// Draw every tile of a lane that is on screen
+void draw_lane_tiles(player_t *p, uint lane) {
+    playfield_t *pf = &p->game.pf;
+    uint n = playfield_tiles(pf, lane);
+    for (uint i = 0; i < n; i++) {
+        uint slot = playfield_slot(pf, lane, i);
+        short y = tile_y(p, pf->tile_pos[lane][slot]);
+        // newer tiles are higher up, so none of them is visible either
+        if (y + TILE_H <= 0) break;
+        short clear_from = -TILE_H;
+        if (i + 1 < n) clear_from = tile_y(p, pf->tile_pos[lane][playfield_slot(pf, lane, i + 1)]) + TILE_H;
+        draw_tile(pf->tile_x[lane],pf->tile_drawn_y[lane][slot],y,pf->tile_w,TILE_H,pf->color[lane],clear_from);
+        pf->tile_drawn_y[lane][slot] = y;
+    }
+}
 
-        // State transition?
-        if (count_0 == BEEP_DURATION) {
-            STATE_0 = 0 ;
-            count_0 = 0 ;
-            flag=0;
+// Take every tile of a player off the screen and out of its lanes
+void clear_tiles(player_t *p) {
+    for (uint lane = 0; lane < p->game.pf.count; lane++) {
+        while (playfield_tiles(&p->game.pf, lane)) {
+            erase_oldest_tile(p, lane);
+            playfield_retire(&p->game.pf, lane);
         }
     }
+}
 
-else if (STATE_0 ==7)
-       {
-        // DDS phase and sine table lookup
-        float y;
-        y=-0.00099853142804*(count_0)*(count_0)+1.99456285608*count_0+1010; 
-        volatile unsigned int phase_incr_main_7 = (y*two32)/Fs ;
-        phase_accum_main_0 += phase_incr_main_7  ;
-        DAC_output_0 = fix2int15(multfix15(current_amplitude_0,
-            sin_table[phase_accum_main_0>>24])) + 2048 ;
-
-        // Ramp up amplitude
-        if (count_0 < ATTACK_TIME) {
-            current_amplitude_0 = (current_amplitude_0 + attack_inc) ;
+// Put back what is under a rectangle of a playfield: black, and the
+// tiles as last drawn (the effects' background; ctx is the player)
+void repaint_region(void *ctx, short x, short y, short w, short h) {
+    const playfield_t *pf = &((player_t *)ctx)->game.pf;
+    fillRect(x,y,w,h,0);
+    for (uint lane = 0; lane < pf->count; lane++) {
+        short x0 = MAX(x, pf->tile_x[lane]);
+        short x1 = MIN(x + w, pf->tile_x[lane] + pf->tile_w);
+        if (x1 <= x0) continue;
+        for (uint i = 0; i < playfield_tiles(pf, lane); i++) {
+            short ty = pf->tile_drawn_y[lane][playfield_slot(pf, lane, i)];
+            if (ty == TILE_HIDDEN) break;
+            fill_rows(x0,MAX(ty,y),MIN(ty+TILE_H,y+h),x1-x0,pf->color[lane]);
         }
-        // Ramp down amplitude
-        else if (count_0 > BEEP_DURATION - DECAY_TIME) {
-            current_amplitude_0 = (current_amplitude_0 - decay_inc) ;
+    }
+}
+
+// Draw a player's half of a frame: the tiles where they will be when
+// the scanout reaches the hit line (music time scanout_us), and the
+// effects as of wall time now_us. Touches nothing outside the player's
+// playfield, so the two players can be drawn on the two cores at once.
+void render_player(player_t *p, uint64_t scanout_us, uint64_t now_us) {
+    playfield_t *pf = &p->game.pf;
+    uint32_t start = time_us_32();
+    draw_lane_indicators(p);
+    if (p->playing) {
+        update_view(p, scanout_us);
+        for (uint lane = 0; lane < pf->count; lane++) draw_lane_tiles(p, lane);
+    }
+    effects_update(&p->effects, (uint32_t)now_us);
+    if (p->hit_lanes) {
+        // a hit lane flashes red at the hit line, then fades, and
+        // throws sparks in its own color
+        for (uint lane = 0; lane < pf->count; lane++) {
+            if (!(p->hit_lanes & LANE_BIT(lane))) continue;
+            effect_flash(&p->effects,pf->tile_x[lane],HIT_LINE_Y,pf->tile_w,TILE_H,RED,HIT_FLASH_US,HIT_FADE_US,(uint32_t)now_us);
+            effect_burst(&p->effects,pf->tile_x[lane] + pf->tile_w/2,HIT_LINE_Y,pf->color[lane],HIT_BURST_US,(uint32_t)now_us);
         }
+        uint32_t input = time_us_32() - (uint32_t)p->hit_input_us;
+        p->hits_shown++;
+        p->input_us += input;
+        if (input > p->input_max_us) p->input_max_us = input;
+#if LATENCY_TRACE
+        // the trace follows player 1, who is always drawn on core 0
+        if (p == &players[0]) latency_frame_written((uint32_t)p->hit_input_us, HIT_LINE_Y);
+#endif
+        p->hit_lanes = 0;
+    }
+    uint32_t us = time_us_32() - start;
+    p->frames++;
+    p->draw_us += us;
+    if (us > p->draw_max_us) p->draw_max_us = us;
+}
 
-        // Mask with DAC control bits
-        DAC_data_0 = (DAC_config_chan_B | (DAC_output_0 & 0xffff))  ;
+void reset_player_stats(player_t *p) {
+    p->frames = p->draw_us = p->draw_max_us = 0;
+    p->hits_shown = p->input_us = p->input_max_us = 0;
+}
 
-        // SPI write (no spinlock b/c of SPI buffer)
-        spi_write16_blocking(SPI_PORT, &DAC_data_0, 1) ;
+// Frame time and input latency of a player since the last call
+void print_player_stats(uint number, player_t *p) {
+    if (p->frames) {
+        printf("player %u: draw %lu us (max %lu)", number + 1,
+               (unsigned long)(p->draw_us / p->frames), (unsigned long)p->draw_max_us);
+        if (p->hits_shown) printf(", input %lu us (max %lu)",
+               (unsigned long)(p->input_us / p->hits_shown), (unsigned long)p->input_max_us);
+        printf("\n");
+    }
+    reset_player_stats(p);
+}
 
-        // Increment the counter
-        count_0 += 1 ;
+#if RENDER_ON_CORE1
+// Player 2's half of a frame, drawn by core 1 (protothread_render).
+// Core 0 fills in the times, then counts the frame in render_requested;
+// core 1 counts it in render_done when it is drawn. Core 0 does not
+// touch player 2 in between.
+volatile uint32_t render_requested, render_done;
+uint64_t render_scanout_us, render_now_us;
+
+void render_on_core1(uint64_t scanout_us, uint64_t now_us) {
+    render_scanout_us = scanout_us;
+    render_now_us = now_us;
+    __dmb();
+    render_requested++;
+}
+#endif
 
-        // State transition?
-        if (count_0 == 2000) {
-            STATE_0 = 0 ;
-            count_0 = 0 ;
-            flag=0;
-        }
+#define SCORE_DIGITS 6
+#define SCORE_DIGIT_W 15
+void update_score(short x, short y, uint score){
+    fillRect(x,y,SCORE_DIGITS*SCORE_DIGIT_W,20,0);
+    /* setCursor(30, 30); */
+    /* setTextSize(3); */
+    for (int i = SCORE_DIGITS - 1; i >= 0; i--) {
+        drawChar(x + SCORE_DIGIT_W*i, y, (score % 10) + '0', WHITE, 0, 2);
+        score /= 10;
     }
+}
 
-    // State transition?
-    else {
-        count_0 += 1 ;
-        if (flag==1) {
-            current_amplitude_0 = 0 ;
-            STATE_0 = 1 ;
-            count_0 = 0 ;
-            flag=0;
-        }
-        if (flag==2) {
-            current_amplitude_0 = 0 ;
-            STATE_0 = 2 ;
-            count_0 = 0 ;
-            flag=0;
-        }
-       
-       if (flag==4) {
-        current_amplitude_0 = 0 ;
-            STATE_0 = 4 ;
-            count_0 = 0 ;
-            flag=0;
-       }
-    
-    if (flag==5) {
-        current_amplitude_0 = 0 ;
-            STATE_0 = 5 ;
-            count_0 = 0 ;
-            flag=0;
-       }
-
-       if (flag==6) {
-        current_amplitude_0 = 0 ;
-            STATE_0 = 6 ;
-            count_0 = 0 ;
-            flag=0;
-       }
+// Where a player's score is drawn: left of the playfield, or in the
+// middle column in the versus mode
+short score_x(void) {
+    return num_players > 1 ? VERSUS_HUD_X + 3 : 30;
+}
+short score_y(uint number) {
+    return 60 + 80*number;
+}
 
-       if (flag==7) {
-        current_amplitude_0 = 0 ;
-            STATE_0 = 7 ;
-            count_0 = 0 ;
-            flag=0;
-       }
+void draw_label(short x, short y, const char *text) {
+    for (uint i = 0; text[i]; i++) drawChar(x + SCORE_DIGIT_W*i, y, text[i], WHITE, 0, 2);
+}
 
+// Score labels and scores of every player
+void draw_hud(void) {
+    for (uint pl = 0; pl < num_players; pl++) {
+        if (num_players > 1) draw_label(score_x(), score_y(pl) - 30, pl ? "P2" : "P1");
+        else draw_label(score_x(), score_y(pl) - 30, "Score:");
+        players[pl].shown_score = 0;
+        update_score(score_x(), score_y(pl), 0);
+    }
+}
 
 
+// Recording and replay of the lane input around each game
+void session_game_start(uint number) {
+    uint64_t now = time_us_64();
+#if INPUT_SESSION == SESSION_REPLAY
+    if (number > 0) {
+        uint32_t len;
+        const uint8_t *stream = input_record_data(&len);
+        input_replay_start(stream, len, now);
+        return;
+    }
+#endif
+#if INPUT_SESSION != SESSION_LIVE
+    input_record_start(now);
+#endif
+}
 
+void session_game_over(uint number, uint score) {
+#if INPUT_SESSION != SESSION_LIVE
+    printf("game %u score %u%s\n", number, score, input_recording() ? " (recorded)" : " (replay)");
+    if (input_recording()) {
+        input_record_stop();
+        if (INPUT_SESSION == SESSION_RECORD) input_record_dump();
     }
+#endif
+}
 
-    // retrieve core number of execution
-    corenum_0 = get_core_num() ;
-    
-    return true;
+// Game states (protothread_core_0)
+#define STATE_ATTRACT   0       // title, until a press
+#define STATE_COUNTDOWN 1       // 3, 2, 1 over the empty playfield
+#define STATE_PLAYING   2
+#define STATE_PAUSED    3       // restart button during play, again to resume
+#define STATE_GAME_OVER 4       // the miss fades out under the message
+#define STATE_RESULTS   5       // score and grades, until a press
+#define STATE_POLL_US   10000   // input polling of the waiting states
+#define ATTRACT_BLINK_US 500000
+#define COUNTDOWN_FROM  3
+#define COUNTDOWN_US    1000000 // per digit
+#define GAME_OVER_US    2000000
+
+// Restart button, edge triggered: true once per press
+static bool restart_level;
+bool restart_pressed(void) {
+    bool level = register_read(RESTART_PIN_REG) != 0;
+    bool edge = level && !restart_level;
+    restart_level = level;
+    return edge;
 }
 
+// Input lanes pressed since the last call, outside of play. The events
+// are drained, so none of them reaches the judge of the next game.
+uint32_t lane_presses(void) {
+    input_event_t event;
+    uint32_t pressed = 0;
+    input_poll();
+    while (input_get_event(&event)) {
+        if (event.edge == INPUT_PRESS) pressed |= LANE_BIT(event.lane);
+    }
+    return pressed;
+}
 
+// A line of big text across the playfield. It is drawn the first time
+// it is shown and saved from the frame buffer; after that, showing it
+// is a copy back in.
+#define BANNER_SIZE     5
+#define BANNER_CHAR_W   (6*BANNER_SIZE)
+#define BANNER_H        (8*BANNER_SIZE)
+#define BANNER_Y        240
+#define BANNER_MAX_CHARS 11
+#define BANNER_BYTES    ((BANNER_MAX_CHARS*BANNER_CHAR_W/2 + 1)*BANNER_H)
+#define COUNTDOWN_X     (PLAYFIELD_LEFT + (PLAYFIELD_WIDTH - BANNER_CHAR_W)/2)
+#define VERSUS_NOTE_X   (COUNTDOWN_X - 40)
+#define VERSUS_NOTE_Y   (BANNER_Y + BANNER_H + 10)
+typedef struct {
+    const char *text;
+    short x;
+    bool cached;
+    unsigned char pixels[BANNER_BYTES];
+} banner_t;
+banner_t banner_title = { "PIANO TILES", 165 };
+banner_t banner_paused = { "PAUSED", 240 };
+banner_t banner_game_over = { "GAME OVER!!", 180 };
+// what the pause banner covered
+unsigned char under_banner[BANNER_BYTES];
+
+short banner_width(const banner_t *b) {
+    return strlen(b->text) * BANNER_CHAR_W;
+}
 
+void show_banner(banner_t *b) {
+    short w = banner_width(b);
+    if (b->cached) {
+        vga_restore_region(b->x, BANNER_Y, w, BANNER_H, b->pixels);
+        return;
+    }
+    for (uint i = 0; b->text[i]; i++) drawChar(b->x + i*BANNER_CHAR_W, BANNER_Y, b->text[i], WHITE, 0, BANNER_SIZE);
+    vga_save_region(b->x, BANNER_Y, w, BANNER_H, b->pixels);
+    b->cached = true;
+}
 
-//**************************************************
+// Take a banner off the screen, putting back what it covered if that
+// was saved, else black
+void hide_banner(const banner_t *b, const unsigned char *under) {
+    if (under) vga_restore_region(b->x, BANNER_Y, banner_width(b), BANNER_H, under);
+    else fillRect(b->x, BANNER_Y, banner_width(b), BANNER_H, 0);
+}
 
+// A player out of a versus game, in the middle of its playfield
+#define OUT_SIZE        4
+void show_out(const player_t *p) {
+    static const char text[] = "OUT";
+    short x = p->game.pf.left + (p->game.pf.width - 3*6*OUT_SIZE)/2;
+    for (uint i = 0; text[i]; i++) drawChar(x + i*6*OUT_SIZE, BANNER_Y, text[i], WHITE, 0, OUT_SIZE);
+}
 
-uint act_adc() {
-    adc_select_input(0);
-    adc_x_raw = adc_read();
-    uint adc_x = 0;
-    input_flex1=0;
-    input_flex2=0;
-    input_flex3=0;
-    input_flex4=0;
-    input_flex1=gpio_get(SELECT_LINE_A);
-    input_flex2=gpio_get(SELECT_LINE_B);
-    input_flex3=gpio_get(SELECT_LINE_C);
-    input_flex4=gpio_get(SELECT_LINE_D);
-//*********************************
- if (input_flex2 == 1 ){
-      adc_x=2;
-        fillRect(MID_VERT,460,60,20,WHITE);
-        fillRect(LEFT_VERT,460,60,20,0);
-        fillRect(THIRD_VERT,460,60,20,0);
-        fillRect(RIGHT_VERT,460,60,20,0);
+// End of game summary, in the playfield, or in each half in the versus
+// mode with the winner marked
+#define RESULTS_X       180
+#define RESULTS_Y       200
+#define RESULTS_W       420
+#define RESULTS_H       120
+#define RESULTS_WINNER_Y (RESULTS_Y - 30)
+void show_results(const player_t *p, short x, bool winner) {
+    char line[40];
+    uint32_t grades[NUM_GRADES] = {0};
+    const judge_t *judge = &p->game.judge;
+    for (uint lane = 0; lane < p->game.pf.count; lane++) {
+        for (uint g = 0; g < NUM_GRADES; g++) grades[g] += judge->lane[lane].grades[g];
     }
-    else if (input_flex4== 1 ) {
-        adc_x=4;
-        fillRect(RIGHT_VERT,460,60,20,WHITE);
-        fillRect(LEFT_VERT,460,60,20,0);
-        fillRect(THIRD_VERT,460,60,20,0);
-        fillRect(MID_VERT,460,60,20,0);
-    }else if (input_flex1==1 ) {
-        adc_x=1;
-        fillRect(LEFT_VERT,460,60,20,WHITE);
-        fillRect(MID_VERT,460,60,20,0);
-        fillRect(THIRD_VERT,460,60,20,0);
-        fillRect(RIGHT_VERT,460,60,20,0);
+    setTextColor2(WHITE, BLACK);
+    setTextSize(2);
+    if (winner) {
+        setCursor(x, RESULTS_WINNER_Y);
+        writeString("Winner!");
     }
-    else if (input_flex3==1 ) {
-        adc_x=3;
-        fillRect(THIRD_VERT,460,60,20,WHITE);
-        fillRect(LEFT_VERT,460,60,20,0);
-        fillRect(MID_VERT,460,60,20,0);
-        fillRect(RIGHT_VERT,460,60,20,0);
-    }
-    else if(adc_x==0)
-    {fillRect(THIRD_VERT,460,60,20,0);
-        fillRect(LEFT_VERT,460,60,20,0);
-        fillRect(MID_VERT,460,60,20,0);
-        fillRect(RIGHT_VERT,460,60,20,0);
+    sprintf(line, "Score %u", (unsigned)judge->score);
+    setCursor(x, RESULTS_Y);
+    writeString(line);
+    sprintf(line, "Max combo %u", (unsigned)judge->max_combo);
+    setCursor(x, RESULTS_Y + 25);
+    writeString(line);
+    setCursor(x, RESULTS_Y + 50);
+    writeString("Perf/great/good/miss");
+    sprintf(line, "%u/%u/%u/%u", (unsigned)grades[JUDGE_PERFECT], (unsigned)grades[JUDGE_GREAT],
+            (unsigned)grades[JUDGE_GOOD], (unsigned)grades[JUDGE_MISS]);
+    setCursor(x, RESULTS_Y + 70);
+    writeString(line);
+    setCursor(x, RESULTS_Y + 100);
+    writeString("Press to play again");
+}
 
+void show_all_results(void) {
+    if (num_players == 1) {
+        show_results(&players[0], RESULTS_X, false);
+        return;
+    }
+    uint s0 = players[0].game.judge.score, s1 = players[1].game.judge.score;
+    for (uint pl = 0; pl < num_players; pl++) {
+        bool winner = pl ? s1 > s0 : s0 > s1;
+        show_results(&players[pl], players[pl].game.pf.left + 8, winner);
     }
-
-    sleep_ms(10);
-    return adc_x;
 }
 
-void draw_fill_rect(short x, short y, short w, short h, char color, short inc_dec){
-    fillRect(x,y,w,h,color);
-    fillRect(x,y,w,inc_dec,0);
-    fillRect(x,y+h,w,inc_dec,color);
-    sleep_ms(10);
+void hide_results(void) {
+    if (num_players == 1) fillRect(RESULTS_X, RESULTS_Y, RESULTS_W, RESULTS_H, 0);
+    else fillRect(0, RESULTS_WINNER_Y, 640, RESULTS_Y + RESULTS_H - RESULTS_WINNER_Y, 0);
 }
 
-void update_score(uint score){
-    fillRect(30,60,240,20,0);
-    /* setCursor(30, 30); */
-    /* setTextSize(3); */
-    char str_score[3] = {'0', '0', '0'};
-    str_score[2] = (score % 10) + '0';
-    str_score[1] = ((score/10) % 10) + '0';
-    str_score[0] = (((score/10)/10) % 10) + '0';
-    drawChar(30, 60, str_score[0], WHITE, 0, 2);
-    drawChar(45, 60, str_score[1], WHITE, 0, 2);
-    drawChar(60, 60, str_score[2], WHITE, 0, 2);
+// A new game for `count` players, with its first logic step at start_us.
+// The screen is cleared for the layout of the mode.
+void game_setup(uint count, uint64_t start_us) {
+    num_players = count;
+    melody_notes = 0;
+    fillRect(0, 0, 640, 480, 0);
+    for (uint pl = 0; pl < num_players; pl++) {
+        player_t *p = &players[pl];
+        game_init(&p->game, beatmap_ode_to_joy, PLAYFIELD_LANES, start_us);
+        if (num_players > 1) playfield_place(&p->game.pf, pl ? VERSUS_RIGHT_X : 0, VERSUS_FIELD_W, pl);
+        p->game.retire_hook = erase_oldest_tile;
+        p->game.hook_ctx = p;
+        effects_init(&p->effects, repaint_region, p, p->game.pf.left, 10, p->game.pf.left + p->game.pf.width, INDICATOR_Y);
+        p->view_pos = 0;
+        p->lanes = p->shown_lanes = p->hit_lanes = 0;
+        p->playing = true;
+        p->hit_steps = 0;
+        reset_player_stats(p);
+    }
+    draw_hud();
+    tempo_start(&tempo, start_us, players[0].game.chart_bpm, players[0].game.chart_ticks_per_beat);
+#if LATENCY_TRACE
+    latency_reset();
+#endif
 }
 
-
-// This thread runs on core 0
+// This thread runs on core 0. The game is a state machine: each state
+// does what is due now and yields, so the thread never waits in place.
 static PT_THREAD (protothread_core_0(struct pt *pt))
 {
     // Indicate thread beginning
     PT_BEGIN(pt) ;
- 
 
-     uint blue_indx = 20, green_indx = 40, cyan_indx = 60, yellow_indx=0, joystick_pos = 0;
-    uint curr_score = 0, buttons_status = 0;
 
-    drawChar(30, 30, 'S', WHITE, 0, 2);
-    drawChar(45, 30, 'c', WHITE, 0, 2);
-    drawChar(60, 30, 'o', WHITE, 0, 2);
-    drawChar(75, 30, 'r', WHITE, 0, 2);
-    drawChar(90, 30, 'e', WHITE, 0, 2);
-    drawChar(105, 30, ':', WHITE, 0, 2);
-    update_score(curr_score);
+    static uint32_t inputs, step;
+    static uint64_t now, music, scanout, next_step, wake_us, fps_start, state_start;
+    static uint steps, frames, logic_steps, fps, logic_hz, in_play;
+    static uint game_number = 0, versus_players = 1;
+    static int state = STATE_ATTRACT, countdown, title_phase = -1;
+    static player_t *p;
 
-    sleep_ms(5000);
+    draw_hud();
+    // a button held at boot (calibration) is not a press
+    restart_pressed();
+    state_start = time_us_64();
 
     while(true) {
-        while (true){
-            joystick_pos = act_adc();
+        now = time_us_64();
+
+        if (state == STATE_ATTRACT) {
+            // the title blinks until a lane or the button is pressed; a
+            // press on player 2's glove starts a versus game. The frame
+            // buffer is only touched when the blink flips.
+            int phase = ((now - state_start) / ATTRACT_BLINK_US) & 1;
+            if (phase != title_phase) {
+                if (phase) hide_banner(&banner_title, NULL);
+                else show_banner(&banner_title);
+                title_phase = phase;
+            }
+            inputs = lane_presses();
+            if (inputs | restart_pressed()) {
+                if (title_phase == 0) hide_banner(&banner_title, NULL);
+                title_phase = -1;
+                versus_players = (inputs & PLAYER_LANES(1)) ? 2 : 1;
+                state = STATE_COUNTDOWN;
+                state_start = now;
+                countdown = -1;
+            }
+        }
+
+        else if (state == STATE_COUNTDOWN) {
+            int left = COUNTDOWN_FROM - (int)((now - state_start) / COUNTDOWN_US);
+            // player 2 can still join
+            if (lane_presses() & PLAYER_LANES(1)) versus_players = 2;
+            if (left != countdown && left > 0) {
+                drawChar(COUNTDOWN_X, BANNER_Y, '0' + left, WHITE, 0, BANNER_SIZE);
+                if (versus_players > 1) {
+                    setTextColor2(WHITE, BLACK);
+                    setTextSize(2);
+                    setCursor(VERSUS_NOTE_X, VERSUS_NOTE_Y);
+                    writeString("2 players");
+                }
+            }
+            countdown = left;
+            if (left <= 0) {
+                fillRect(COUNTDOWN_X, BANNER_Y, BANNER_CHAR_W, BANNER_H, 0);
+                // music time starts with the song
+                game_setup(versus_players, now);
+                audio_play(SOUND_SONG_START);
+                step = 0;
+                next_step = now;
+                session_game_start(game_number);
+                fps_start = now;
+                frames = logic_steps = 0;
+                state = STATE_PLAYING;
+            }
+        }
+
+        else if (state == STATE_PLAYING) {
+            if (restart_pressed()) {
+                // freeze the game under the banner
+                audio_play(SOUND_SONG_STOP);
+                vga_save_region(banner_paused.x, BANNER_Y, banner_width(&banner_paused), BANNER_H, under_banner);
+                show_banner(&banner_paused);
+                state = STATE_PAUSED;
+                state_start = now;
+                continue;
+            }
+            ////////////////////////////////////////////////////////////////
+            // Logic: every step the song has reached, each at its own
+            // time, for every player still in. None is dropped after a
+            // stall: the song went on.
+            music = tempo_update(&tempo, audio_song_clock, now);
+            for (steps = 0; state == STATE_PLAYING && next_step <= music; steps++) {
+                // events up to now are in the input ring once act_adc() returns
+                act_adc();
+#if LATENCY_TRACE
+                latency_poll();
+#endif
+                in_play = 0;
+                for (uint pl = 0; pl < num_players; pl++) {
+                    p = &players[pl];
+                    if (!p->playing) continue;
+                    game_step(&p->game, input_latency_us());
+                    if (p->game.hits) {
+                        // the feedback is drawn with the next frame
+                        if (!p->hit_lanes) p->hit_input_us = tempo_to_wall(&tempo, p->game.hit_input_us);
+                        p->hit_lanes |= p->game.hits;
+                        if (++p->hit_steps > melody_notes) {
+                            melody_notes = p->hit_steps;
+#if LATENCY_TRACE
+                            if (pl == 0) latency_sound_requested((uint32_t)tempo_to_wall(&tempo, p->game.hit_input_us));
+#endif
+                            audio_play(SOUND_MELODY_NOTE);
+                        }
+                    }
+                    if (p->game.over) {
+                        p->playing = false;
+                        // the other player plays on
+                        if (num_players > 1) {
+                            clear_tiles(p);
+                            show_out(p);
+                        }
+                        for (uint lane = 0; lane < p->game.pf.count; lane++) {
+                            if (p->game.missed & LANE_BIT(lane)) effect_flash(&p->effects,p->game.pf.tile_x[lane],HIT_LINE_Y,p->game.pf.tile_w,TILE_H,WHITE,MISS_FLASH_US,MISS_FADE_US,(uint32_t)tempo_to_wall(&tempo, next_step));
+                        }
+                        audio_play(SOUND_GAME_OVER);
+                    }
+                    else in_play++;
+                }
+                if (!in_play) {
+                    audio_play(SOUND_SONG_STOP);
+                    state = STATE_GAME_OVER;
+                }
+                next_step = game_step_us(&players[0].game, ++step);
+                logic_steps++;
+            }
+            if (state == STATE_GAME_OVER) {
+                for (uint pl = 0; pl < num_players; pl++) {
+                    if (num_players > 1) printf("player %u: ", pl + 1);
+                    judge_print(&players[pl].game.judge, players[pl].game.pf.count);
+                    players[pl].lanes = 0;
+                    draw_lane_indicators(&players[pl]);
+                    clear_tiles(&players[pl]);
+                }
+                tempo_print(&tempo);
+#if LATENCY_TRACE
+                latency_print();
+#endif
+                session_game_over(game_number++, players[0].game.judge.score);
+                show_banner(&banner_game_over);
+                state_start = now;
+                continue;
+            }
+
+            ////////////////////////////////////////////////////////////////
+            // Render what changed since the last frame, one half of the
+            // screen per player
             char info[100];
-      sprintf(info, "ADC:%d| ", adc_x_raw);
+      if (num_players > 1) {
+      sprintf(info, "%3u fps", fps);
+      setCursor(VERSUS_HUD_X + 3,0);
+      }
+      else {
+      sprintf(info, "ADC:%d| %-7s combo %-5u %3u fps ", adc_x_raw,
+              players[0].game.last_grade == JUDGE_NONE ? "" : judge_grade_name(players[0].game.last_grade), (unsigned)players[0].game.judge.combo, fps);
       setCursor(0,0);
+      }
       setTextColor2(WHITE, BLACK);
       setTextSize(1);
       writeString(info);
 
-
-
-            if (cyan_indx > 355/speed_fact) {
-                cyan_indx = 0;
-                fillRect(RIGHT_VERT_TILES,360,40,100,0);
-                if (joystick_pos ==4) {
-                    sleep_ms(40);
-                    fillRect(RIGHT_VERT_TILES,360,40,100,RED);
-                    flag=1;
-                    sleep_ms(40);
-                    fillRect(RIGHT_VERT_TILES,360,40,100,0);
-                    curr_score += 1;
-                    update_score(curr_score);
-                } else {
-                    fillRect(RIGHT_VERT,460,60,20,0);
-                    flag=2;
-                    break;
+            scanout = scanout_time(music);
+#if RENDER_ON_CORE1
+            if (num_players > 1) {
+                render_on_core1(scanout, now);
+                render_player(&players[0], scanout, now);
+                PT_YIELD_UNTIL(pt, render_done == render_requested);
+                __dmb();
+            }
+            else render_player(&players[0], scanout, now);
+#else
+            for (uint pl = 0; pl < num_players; pl++) render_player(&players[pl], scanout, now);
+#endif
+            for (uint pl = 0; pl < num_players; pl++) {
+                p = &players[pl];
+                if (p->game.judge.score != p->shown_score) {
+                    p->shown_score = p->game.judge.score;
+                    update_score(score_x(), score_y(pl), p->shown_score);
                 }
             }
+            frames++;
+
+            // frames and logic steps per second, on screen and over USB
+            if (now - fps_start >= FPS_REPORT_US) {
+                fps = (uint64_t)frames * 1000000 / (now - fps_start);
+                logic_hz = (uint64_t)logic_steps * 1000000 / (now - fps_start);
+                printf("%u fps, logic %u Hz, %u px/s, tick %u, drift %ld us\n", fps, logic_hz,
+                       scroll_px_per_s(&players[0].game.scroll, LOGIC_HZ), (unsigned)tempo_ticks(&tempo), (long)tempo.drift_us);
+                for (uint pl = 0; pl < num_players; pl++) print_player_stats(pl, &players[pl]);
+                fps_start = now;
+                frames = logic_steps = 0;
+            }
 
+        }
 
-            if (yellow_indx > 355/speed_fact) {
-                yellow_indx = 0;
-                fillRect(THIRD_VERT_TILES,360,40,100,0);
-                if (joystick_pos ==3) {
-                    sleep_ms(40);
-                    fillRect(THIRD_VERT_TILES,360,40,100,RED);
-                    flag=1;
-                    sleep_ms(40);
-                    fillRect(THIRD_VERT_TILES,360,40,100,0);
-                    curr_score += 1;
-                    update_score(curr_score);
-                } else {
-                    fillRect(THIRD_VERT,460,60,20,0);
-                    flag=2;
-                    break;
-                }
+        else if (state == STATE_PAUSED) {
+            lane_presses();
+            if (restart_pressed()) {
+                // the song picks up where it stopped, and the game with it:
+                // music time did not move during the pause
+                uint64_t paused = now - state_start;
+                hide_banner(&banner_paused, under_banner);
+                tempo_resume(&tempo, paused);
+                fps_start += paused;
+                audio_play(SOUND_SONG_RESUME);
+                state = STATE_PLAYING;
             }
+        }
 
-            if (green_indx > 355/speed_fact) {
-                green_indx = 0;
-                fillRect(MID_VERT_TILES,360,40,100,0);
-                if (joystick_pos == 2) {
-                    sleep_ms(40);
-                    fillRect(MID_VERT_TILES,360,40,100,RED);
-                    flag=1;
-                    sleep_ms(40);
-                    fillRect(MID_VERT_TILES,360,40,100,0);
-                    curr_score += 1;
-                    update_score(curr_score);
-                } else {
-                    fillRect(MID_VERT,460,60,20,0);
-                    flag=2;
-                    break;
-                }
+        else if (state == STATE_GAME_OVER) {
+            // the miss fades out behind the message
+            lane_presses();
+            for (uint pl = 0; pl < num_players; pl++) effects_update(&players[pl].effects, (uint32_t)now);
+            if (restart_pressed() || now - state_start >= GAME_OVER_US) {
+                for (uint pl = 0; pl < num_players; pl++) effects_clear(&players[pl].effects);
+                hide_banner(&banner_game_over, NULL);
+                show_all_results();
+                state = STATE_RESULTS;
             }
+        }
 
-            if (blue_indx > 355/speed_fact) {
-                blue_indx = 0;
-                fillRect(LEFT_VERT_TILES,360,40,100,0);
-                if (joystick_pos==1) {
-                    sleep_ms(40);
-                    fillRect(LEFT_VERT_TILES,360,40,100,RED);
-                    flag=1;
-                    sleep_ms(40);
-                    fillRect(LEFT_VERT_TILES,360,40,100,0);
-                    curr_score += 1;
-                    update_score(curr_score);
-                } else {
-                    fillRect(LEFT_VERT,460,60,20,0);
-                    flag=2;
-                    break;
-                }
+        else if (state == STATE_RESULTS) {
+            inputs = lane_presses();
+            if (inputs | restart_pressed()) {
+                hide_results();
+                versus_players = (inputs & PLAYER_LANES(1)) ? 2 : 1;
+                state = STATE_COUNTDOWN;
+                state_start = now;
+                countdown = -1;
             }
-            
-
-            draw_fill_rect(LEFT_VERT_TILES,(blue_indx*speed_fact),40,100,BLUE,speed_fact);
-            draw_fill_rect(MID_VERT_TILES,(green_indx*speed_fact),40,100,GREEN,speed_fact);
-            draw_fill_rect(RIGHT_VERT_TILES,(cyan_indx*speed_fact),40,100,CYAN,speed_fact);
-             draw_fill_rect(THIRD_VERT_TILES,(yellow_indx*speed_fact),40,100,YELLOW,speed_fact);
-            cyan_indx++;
-            green_indx++;
-            blue_indx++;
-            yellow_indx++;
-            //speed_fact= speed_fact+ 0.1;
         }
 
-        fillRect(LEFT_VERT_TILES,(blue_indx*speed_fact),40,100,0);
-        fillRect(MID_VERT_TILES,(green_indx*speed_fact),40,100,0);
-        fillRect(RIGHT_VERT_TILES,(cyan_indx*speed_fact),40,100,0);
-         fillRect(THIRD_VERT_TILES,(yellow_indx*speed_fact),40,100,0);
-
-        drawChar(180, 240, 'G', WHITE, 0, 5);
-        drawChar(210, 240, 'A', WHITE, 0, 5);
-        drawChar(240, 240, 'M', WHITE, 0, 5);
-        drawChar(270, 240, 'E', WHITE, 0, 5);
-        drawChar(300, 240, ' ', WHITE, 0, 5);
-        drawChar(330, 240, 'O', WHITE, 0, 5);
-        drawChar(360, 240, 'V', WHITE, 0, 5);
-        drawChar(390, 240, 'E', WHITE, 0, 5);
-        drawChar(420, 240, 'R', WHITE, 0, 5);
-        drawChar(450, 240, '!', WHITE, 0, 5);
-        drawChar(480, 240, '!', WHITE, 0, 5);
-        
-        buttons_status = register_read(RESTART_PIN_REG);
-        printf("0x%08x\n", buttons_status);
-        while (buttons_status == 0){
-            buttons_status = register_read(RESTART_PIN_REG);
-            printf("0x%08x\n", buttons_status);
-            sleep_ms(10);
+        // let the other threads run: until the next logic step is due
+        // while playing, for a poll interval in the waiting states
+        if (state == STATE_PLAYING) {
+            // asleep, off the scheduler's run list, until the step is due
+            wake_us = tempo_to_wall(&tempo, next_step);
+            pt_sleep_until((unsigned int)wake_us);
+            PT_YIELD_UNTIL(pt, time_us_64() >= wake_us);
         }
+        else PT_YIELD_usec(STATE_POLL_US);
+    }
 
-        fillRect(180,240,400,100,0);
-        curr_score = 0;
-        update_score(curr_score);
+    // Indicate thread end
+    PT_END(pt) ;
+}
 
-        }
-    
+// This thread runs on core 0, every INPUT_POLL_US (SCHED_RATE)
+// Keeps the lane filters fed at a steady rate, and the backend's queues
+// drained, while the game thread sleeps or draws. The game polls as
+// well before each logic step, so a step sees every press up to it.
+static PT_THREAD (protothread_input(struct pt *pt))
+{
+    PT_BEGIN(pt) ;
+
+    while(true) {
+        input_poll() ;
+        PT_YIELD(pt) ;
+    }
 
+    PT_END(pt) ;
+}
 
 
 
-    // Indicate thread end
-    PT_END(pt) ;
+
+
+
+
+
+
+// Boot-time calibration of the analog flex sensors. Runs before core 1
+// is started, which is required to write the calibration to flash.
+#define CALIBRATION_SETTLE_MS 3000
+void calibrate_flex_sensors() {
+    adc_calibration_t cal;
+    setTextColor2(WHITE, BLACK);
+    setTextSize(2);
+
+    setCursor(180, 200);
+    writeString("Straighten all fingers");
+    sleep_ms(CALIBRATION_SETTLE_MS);
+    adc_input_average(cal.rest);
+
+    setCursor(180, 200);
+    writeString("Bend all fingers      ");
+    sleep_ms(CALIBRATION_SETTLE_MS);
+    adc_input_average(cal.full);
+
+    adc_input_save_calibration(&cal);
+    fillRect(0, 190, 640, 40, 0);
 }
 
+// How often core 1 reports the audio ISR load over USB
+#define AUDIO_STATS_INTERVAL_US 2000000
 
+#if AUDIO_ON_CORE1
+// This thread runs on core 1, every AUDIO_CMD_PERIOD_US (SCHED_RATE)
+// Sound requests from the game loop arrive through the SIO FIFO; each
+// run hands every word waiting there to the engine. The period bounds
+// the delay a hit sound gets on top of the ISR's.
+#define AUDIO_CMD_PERIOD_US 250
+static PT_THREAD (protothread_audio_cmd(struct pt *pt))
+{
+    PT_BEGIN(pt) ;
 
+    while(true) {
+        while (multicore_fifo_rvalid()) audio_command(multicore_fifo_pop_blocking()) ;
+        PT_YIELD(pt) ;
+    }
 
+    PT_END(pt) ;
+}
+#endif
 
+// This thread runs on core 1, every AUDIO_STATS_INTERVAL_US (SCHED_RATE)
+// Reports audio ISR load (and, with AUDIO_ON_CORE1, what core 0 got back)
+static PT_THREAD (protothread_audio_stats(struct pt *pt))
+{
+    PT_BEGIN(pt) ;
 
+    while(true) {
+        PT_YIELD(pt) ;
+        audio_print_stats() ;
+    }
 
+    PT_END(pt) ;
+}
 
-int main() {
+#if RENDER_ON_CORE1
+// This thread runs on core 1
+// Draws player 2's half of each versus frame, while core 0 draws player 1's
+static PT_THREAD (protothread_render(struct pt *pt))
+{
+    PT_BEGIN(pt) ;
 
-    gpio_init(RESTART_PIN);
-    gpio_set_dir(RESTART_PIN, GPIO_IN);
+    while(true) {
+        PT_YIELD_UNTIL(pt, render_done != render_requested) ;
+        __dmb() ;
+        render_player(&players[1], render_scanout_us, render_now_us) ;
+        __dmb() ;
+        render_done = render_requested ;
+    }
 
-     gpio_init(SELECT_LINE_A);
-    gpio_set_dir(SELECT_LINE_A, GPIO_IN);
+    PT_END(pt) ;
+}
+#endif
+
+// Core 1 entry point
+void core1_main() {
+#if AUDIO_ON_CORE1
+    // timer IRQs land on the core that creates the alarm pool
+    audio_timer_start() ;
+    pt_add_thread_rate(protothread_audio_cmd, AUDIO_CMD_PERIOD_US) ;
+#endif
+    pt_add_thread_rate(protothread_audio_stats, AUDIO_STATS_INTERVAL_US) ;
+#if RENDER_ON_CORE1
+    pt_add_thread(protothread_render) ;
+#endif
+    pt_schedule_start ;
+}
 
-    gpio_init(SELECT_LINE_B);
-    gpio_set_dir(SELECT_LINE_B, GPIO_IN);
+int main() {
 
-    gpio_init(SELECT_LINE_C);
-    gpio_set_dir(SELECT_LINE_C, GPIO_IN);
+    gpio_init(RESTART_PIN);
+    gpio_set_dir(RESTART_PIN, GPIO_IN);
 
-    gpio_init(SELECT_LINE_D);
-    gpio_set_dir(SELECT_LINE_D, GPIO_IN);
     // Initialize stdio
     stdio_init_all();
 
@@ -687,54 +975,28 @@ int main() {
     adc_init();
     // Make sure GPIO is high-impedance, no pullups etc
     adc_gpio_init(26);
-  
-//****************************************
- // Initialize SPI channel (channel, baud rate set to 20MHz)
-    spi_init(SPI_PORT, 20000000) ;
-    // Format (channel, data bits per transfer, polarity, phase, order)
-    spi_set_format(SPI_PORT, 16, 0, 0, 0);
-
-    // Map SPI signals to GPIO ports
-    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_CS, GPIO_FUNC_SPI) ;
-
-    // Map LDAC pin to GPIO port, hold it low (could alternatively tie to GND)
-    gpio_init(LDAC) ;
-    gpio_set_dir(LDAC, GPIO_OUT) ;
-    gpio_put(LDAC, 0) ;
-
-    // Map LED to GPIO port, make it low
-    gpio_init(LED) ;
-    gpio_set_dir(LED, GPIO_OUT) ;
-    gpio_put(LED, 0) ;
-
-
-    gpio_init(ISR) ;
-    gpio_set_dir(ISR, GPIO_OUT) ;
-    gpio_put(ISR, 0) ;
-
-// set up increments for calculating bow envelope
-    attack_inc = divfix(max_amplitude, int2fix15(ATTACK_TIME)) ;
-    decay_inc =  divfix(max_amplitude, int2fix15(DECAY_TIME)) ;
-
-    // Build the sine lookup table
-    // scaled to produce values between 0 and 4096 (for 12-bit DAC)
-    int ii;
-    for (ii = 0; ii < sine_table_size; ii++){
-         sin_table[ii] = float2fix15(2047*sin((float)ii*6.283/(float)sine_table_size));
-    }
-
-    // Create a repeating timer that calls 
-    // repeating_timer_callback (defaults core 0)
-    struct repeating_timer timer_core_0;
-
-    // Negative delay so means we will call repeating_timer_callback, and call it
-    // again 25us (40kHz) later regardless of how long the callback took to execute
-    add_repeating_timer_us(-25, 
-        repeating_timer_callback_core_0, NULL, &timer_core_0);
 
+    // lane inputs; GPIO edge interrupts and the ADC DMA ring both
+    // timestamp lane changes on core 0
+    input_init(INPUT_BACKEND, INPUT_FILTER);
+    printf("input filter %s adds %u us\n", input_filter_name(), (unsigned)input_latency_us());
+#if INPUT_BACKEND == INPUT_ADC_DMA
+    // hold RESTART while powering up to calibrate the flex sensors
+    if (register_read(RESTART_PIN_REG)) calibrate_flex_sensors();
+#endif
+  
+    // DAC, sine table and the audio ISR
+    audio_init() ;
+#if !AUDIO_ON_CORE1
+    audio_timer_start() ;
+#endif
+    // both cores run only the threads that are due: sound commands and
+    // input polling at a fixed rate, the USB report every couple of
+    // seconds, and the game and the render when they are not asleep
+    pt_sched_method = SCHED_RATE ;
+    // start core 1, which owns the 40 kHz audio timer (AUDIO_ON_CORE1)
+    // and reports the audio load
+    multicore_launch_core1(core1_main) ;
 
 //*******************************************
   
@@ -743,6 +1005,7 @@ int main() {
 
         // Add core 0 threads
     pt_add_thread(protothread_core_0) ;
+    pt_add_thread_rate(protothread_input, INPUT_POLL_US) ;
         pt_schedule_start ;
     
 }
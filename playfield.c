@@ -0,0 +1,58 @@
+/**
+ * Lane layout and per-lane state of the playfield
+ *
+ */
+#include <string.h>
+#include "vga_graphics.h"
+#include "playfield.h"
+
+// tile colors, left to right (RED is the hit flash, WHITE the indicators)
+static const char lane_palette[] = { BLUE, GREEN, YELLOW, CYAN, MAGENTA } ;
+#define PALETTE_SIZE (sizeof(lane_palette)/sizeof(lane_palette[0]))
+
+static void layout(playfield_t *pf, uint lanes, short left, short width, uint player) {
+    if (lanes < 1) lanes = 1 ;
+    if (lanes > PLAYFIELD_MAX_LANES) lanes = PLAYFIELD_MAX_LANES ;
+    memset(pf, 0, sizeof(*pf)) ;
+    pf->count = lanes ;
+    pf->left = left ;
+    pf->width = width ;
+
+    short pitch = width / lanes ;
+    if (pitch > LANE_MAX_PITCH) pitch = LANE_MAX_PITCH ;
+    // 40 and 60 pixels at the original pitch
+    pf->tile_w = pitch * 4 / 9 ;
+    pf->indicator_w = pitch * 2 / 3 ;
+
+    for (uint lane = 0; lane < lanes; lane++) {
+        pf->tile_x[lane] = left + lane*pitch + (pitch - pf->tile_w) / 2 ;
+        pf->indicator_x[lane] = pf->tile_x[lane] + (pf->tile_w - pf->indicator_w) / 2 ;
+        pf->color[lane] = lane_palette[lane % PALETTE_SIZE] ;
+        pf->input_lanes[player*LANES_PER_PLAYER + lane % LANES_PER_PLAYER] |= 1u << lane ;
+    }
+}
+
+void playfield_layout(playfield_t *pf, uint lanes) {
+    layout(pf, lanes, PLAYFIELD_LEFT, PLAYFIELD_WIDTH, 0) ;
+}
+
+void playfield_place(playfield_t *pf, short left, short width, uint player) {
+    layout(pf, pf->count, left, width, player) ;
+}
+
+bool playfield_spawn(playfield_t *pf, uint lane, uint32_t arrival, uint32_t pos) {
+    if (playfield_tiles(pf, lane) == LANE_TILES) {
+        pf->tiles_dropped++ ;
+        return false ;
+    }
+    uint slot = pf->tile_head[lane] & (LANE_TILES - 1) ;
+    pf->tile_arrival[lane][slot] = arrival ;
+    pf->tile_pos[lane][slot] = pos ;
+    pf->tile_drawn_y[lane][slot] = TILE_HIDDEN ;
+    pf->tile_head[lane]++ ;
+    return true ;
+}
+
+void playfield_retire(playfield_t *pf, uint lane) {
+    if (playfield_tiles(pf, lane)) pf->tile_tail[lane]++ ;
+}
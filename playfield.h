@@ -0,0 +1,80 @@
+/**
+ * Lane layout and per-lane state of the playfield
+ *
+ * Structure of arrays: one array per property, indexed by playfield
+ * lane, so the game loop walks every lane with one loop whatever the
+ * lane count. playfield_layout() lays out 4, 6 or 8 lanes at run time;
+ * with 4 lanes it gives the original screen positions.
+ *
+ * Each input lane (sensor) drives a mask of playfield lanes. With fewer
+ * sensors than lanes they wrap around, so a wide layout can be tried
+ * with the four-sensor glove. A playfield takes one player's glove; in
+ * the versus mode two playfields share the screen side by side.
+ *
+ * The tiles in flight in a lane are a fixed ring, oldest (lowest on
+ * screen) first: spawning writes at the head, retiring the arrived tile
+ * advances the tail, and nothing is ever allocated.
+ *
+ */
+#ifndef PLAYFIELD_H
+#define PLAYFIELD_H
+
+#include "pico/stdlib.h"
+#include "input.h"
+
+#define PLAYFIELD_MAX_LANES 8
+
+// Screen geometry shared by every layout
+#define PLAYFIELD_LEFT      135     // left edge of the first lane's column
+#define PLAYFIELD_WIDTH     495
+#define LANE_MAX_PITCH      90      // 4 lanes: the original 90 pixel spacing
+#define TILE_H              100
+#define HIT_LINE_Y          360     // where the hit flash is drawn
+#define INDICATOR_Y         460
+#define INDICATOR_H         20
+
+#define LANE_TILES          16      // tiles in flight per lane, power of two
+#define TILE_HIDDEN         -32768  // tile_drawn_y of a tile not on screen yet
+
+typedef struct {
+    uint8_t count ;
+    short left ;                // columns the lanes are laid out in
+    short width ;
+    short tile_w ;
+    short indicator_w ;
+    // layout
+    short tile_x[PLAYFIELD_MAX_LANES] ;
+    short indicator_x[PLAYFIELD_MAX_LANES] ;
+    char color[PLAYFIELD_MAX_LANES] ;
+    // playfield lanes driven by each input lane
+    uint32_t input_lanes[NUM_LANES] ;
+    // tiles in flight
+    uint32_t tile_arrival[PLAYFIELD_MAX_LANES][LANE_TILES] ;  // logic step
+    uint32_t tile_pos[PLAYFIELD_MAX_LANES][LANE_TILES] ;      // scroll at arrival, 16.16 px
+    short tile_drawn_y[PLAYFIELD_MAX_LANES][LANE_TILES] ;
+    uint8_t tile_head[PLAYFIELD_MAX_LANES] ;
+    uint8_t tile_tail[PLAYFIELD_MAX_LANES] ;
+    uint32_t tiles_dropped ;                    // spawns into a full lane
+} playfield_t ;
+
+// Lay out lanes (4, 6 or 8; clamped to 1..PLAYFIELD_MAX_LANES), with
+// no tiles in flight, across the screen for player 1
+void playfield_layout(playfield_t *pf, uint lanes) ;
+// Lay the same lanes out again in columns [left, left + width), for a
+// player's glove; only before any tile is in flight
+void playfield_place(playfield_t *pf, short left, short width, uint player) ;
+
+static inline uint playfield_tiles(const playfield_t *pf, uint lane) {
+    return (uint8_t)(pf->tile_head[lane] - pf->tile_tail[lane]) ;
+}
+// Slot of the n-th oldest tile of a lane
+static inline uint playfield_slot(const playfield_t *pf, uint lane, uint n) {
+    return (pf->tile_tail[lane] + n) & (LANE_TILES - 1) ;
+}
+// Add a tile arriving at the hit line at logic step arrival, when the
+// scroll (scroll.h) is at pos; false if the lane is full
+bool playfield_spawn(playfield_t *pf, uint lane, uint32_t arrival, uint32_t pos) ;
+// Drop the oldest tile of a lane
+void playfield_retire(playfield_t *pf, uint lane) ;
+
+#endif
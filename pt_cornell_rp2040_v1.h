@@ -541,12 +541,21 @@ struct pt_sem {
 //=== BRL4 additions for rp2040 =======================================
 //=====================================================================
 
+// Times on the 32-bit usec counter (timerawl) are compared as a signed
+// difference, which stays right when the counter wraps (every 71
+// minutes), for times less than 35 minutes apart
+#define PT_TIME_DUE(now, t) ((int)((unsigned int)(now) - (unsigned int)(t)) >= 0)
+#define PT_TIME_BEFORE(a, b) ((int)((unsigned int)(a) - (unsigned int)(b)) < 0)
+
 // macro to make a thread execution pause in usec
-// max time of about one hour
+// max time of about 35 minutes
+// The thread sleeps: the scheduler keeps it off the run list until it
+// is due (pt_sleep_until), rather than resuming it to check the time
 #define PT_YIELD_usec(delay_time)  \
     do { static unsigned int time_thread ;\
     time_thread = timer_hw->timerawl + (unsigned int)delay_time ; \
-    PT_YIELD_UNTIL(pt, (timer_hw->timerawl >= time_thread)); \
+    pt_sleep_until(time_thread) ; \
+    PT_YIELD_UNTIL(pt, PT_TIME_DUE(timer_hw->timerawl, time_thread)); \
     } while(0);
 
 // macro to return system time
@@ -554,11 +563,19 @@ struct pt_sem {
 
 // macros for interval yield
 // attempts to make interval equal to specified value
-#define PT_INTERVAL_INIT() static unsigned int pt_interval_marker
+// the marker is seeded from the timer on first use, so a thread that
+// starts after the 32-bit timer has run halfway does not sleep to the wrap
+#define PT_INTERVAL_INIT() static unsigned int pt_interval_marker ; \
+    static bool pt_interval_seeded
 //
 #define PT_YIELD_INTERVAL(interval_time)  \
     do { \
-    PT_YIELD_UNTIL(pt, (timer_hw->timerawl >= pt_interval_marker)); \
+    if (!pt_interval_seeded) { \
+        pt_interval_seeded = true ; \
+        pt_interval_marker = timer_hw->timerawl ; \
+    } \
+    pt_sleep_until(pt_interval_marker) ; \
+    PT_YIELD_UNTIL(pt, PT_TIME_DUE(timer_hw->timerawl, pt_interval_marker)); \
     pt_interval_marker = timer_hw->timerawl + (unsigned int)interval_time; \
     } while(0);
 //
@@ -670,6 +687,10 @@ struct ptx {
   struct pt pt;              // thread context
   int num;                    // thread number
   char (*pf)(struct pt *pt); // pointer to thread function
+  unsigned int period;       // SCHED_RATE: usec between runs, 0 = whenever there is time
+  unsigned int next_due;     // SCHED_RATE: timerawl when it is next due
+  unsigned int wake;         // timerawl it sleeps until (PT_YIELD_usec)
+  char asleep;               // off the run list until wake
 };
 
 // === extended structure for scheduler ===============
@@ -682,8 +703,8 @@ static struct ptx pt_thread_list1[MAX_THREADS];
 // see https://github.com/edartuz/c-ptx/tree/master/src
 // and the license above
 // add an entry to the thread list
-//struct ptx *pt_add( char (*pf)(struct pt *pt), int rate) {
-int pt_add( char (*pf)(struct pt *pt)) {
+// rate is the thread's period in usec for SCHED_RATE (0 for none)
+int pt_add( char (*pf)(struct pt *pt), unsigned int rate) {
   if (pt_task_count < (MAX_THREADS)) {
         // get the current thread table entry 
     struct ptx *ptx = &pt_thread_list[pt_task_count];
@@ -691,6 +712,10 @@ int pt_add( char (*pf)(struct pt *pt)) {
     ptx->num   = pt_task_count;
         // function pointer
     ptx->pf    = pf;
+        // due at once, then every rate usec
+    ptx->period   = rate;
+    ptx->next_due = timer_hw->timerawl;
+    ptx->asleep   = 0;
     //
     PT_INIT( &ptx->pt );
         // count of number of defined threads
@@ -702,8 +727,8 @@ int pt_add( char (*pf)(struct pt *pt)) {
 }
 
 // core 1 -- add an entry to the thread list
-//struct ptx *pt_add( char (*pf)(struct pt *pt), int rate) {
-int pt_add1( char (*pf)(struct pt *pt)) {
+// rate is the thread's period in usec for SCHED_RATE (0 for none)
+int pt_add1( char (*pf)(struct pt *pt), unsigned int rate) {
   if (pt_task_count1 < (MAX_THREADS)) {
         // get the current thread table entry 
     struct ptx *ptx = &pt_thread_list1[pt_task_count1];
@@ -711,6 +736,10 @@ int pt_add1( char (*pf)(struct pt *pt)) {
     ptx->num   = pt_task_count1;
         // function pointer
     ptx->pf    = pf;
+        // due at once, then every rate usec
+    ptx->period   = rate;
+    ptx->next_due = timer_hw->timerawl;
+    ptx->asleep   = 0;
     //
     PT_INIT( &ptx->pt );
         // count of number of defined threads
@@ -748,32 +777,142 @@ SOFTWARE.
 // https://github.com/edartuz/c-ptx
 // see license above
 
+// === sleeping threads ================================
+// A thread in PT_YIELD_usec or PT_YIELD_INTERVAL is asleep until its
+// wake time. The scheduler of its core keeps it in a min-heap on the
+// wake time, and only looks at the top: each pass wakes the threads
+// that are due, and does not call the others at all.
+struct pt_sleep_heap {
+  struct ptx *ptx[MAX_THREADS];
+  int count;
+};
+static struct pt_sleep_heap pt_sleepers, pt_sleepers1;
+// thread each core's scheduler is running, NULL between threads
+static struct ptx *pt_running[2];
+
+// put the running thread to sleep until wake, once it yields; a no-op
+// outside the scheduler, where the thread just polls the time
+static void pt_sleep_until(unsigned int wake) {
+  struct ptx *ptx = pt_running[get_core_num()];
+  if (ptx == NULL) return;
+  ptx->wake = wake;
+  ptx->asleep = 1;
+}
+
+static void pt_sleep_push(struct pt_sleep_heap *h, struct ptx *ptx) {
+  int i = h->count++;
+  // sift up
+  while (i > 0 && PT_TIME_BEFORE(ptx->wake, h->ptx[(i-1)/2]->wake)) {
+    h->ptx[i] = h->ptx[(i-1)/2];
+    i = (i-1)/2;
+  }
+  h->ptx[i] = ptx;
+}
+
+static void pt_sleep_pop(struct pt_sleep_heap *h) {
+  struct ptx *last = h->ptx[--h->count];
+  int i = 0, child;
+  // sift the last one down from the top
+  while ((child = 2*i + 1) < h->count) {
+    if (child + 1 < h->count && PT_TIME_BEFORE(h->ptx[child+1]->wake, h->ptx[child]->wake)) child++;
+    if (!PT_TIME_BEFORE(h->ptx[child]->wake, last->wake)) break;
+    h->ptx[i] = h->ptx[child];
+    i = child;
+  }
+  h->ptx[i] = last;
+}
+
+// back on the run list: every sleeper whose wake time has come
+static void pt_wake_due(struct pt_sleep_heap *h, unsigned int now) {
+  while (h->count && PT_TIME_DUE(now, h->ptx[0]->wake)) {
+    h->ptx[0]->asleep = 0;
+    pt_sleep_pop(h);
+  }
+}
+
+// call a thread on this core; into the heap if it went to sleep
+static void pt_run(struct pt_sleep_heap *h, struct ptx *ptx) {
+  int core = get_core_num();
+  pt_running[core] = ptx;
+  (ptx->pf)(&ptx->pt);
+  pt_running[core] = NULL;
+  if (ptx->asleep) pt_sleep_push(h, ptx);
+}
+
 // choose schedule method
 #define SCHED_ROUND_ROBIN 0
 #define SCHED_RATE 1
 int pt_sched_method = SCHED_ROUND_ROBIN ;
 
+// === rate scheduling ==================================
+// With SCHED_RATE a thread runs only when it is due, instead of on
+// every pass. Each pass runs the due thread with the earliest deadline,
+// then moves its deadline on by its period, so a rated thread keeps its
+// cadence however long the others take. A thread with period 0 is due
+// again as soon as it has run, with the time it ran as its deadline:
+// those threads share what the rated ones leave, round robin. A thread
+// that sleeps is not due until it wakes. Deadlines are compared wrap
+// safe (PT_TIME_DUE).
+
+// the due thread with the earliest deadline, or NULL if none is due
+static struct ptx *pt_earliest_due(struct ptx *list, int count, unsigned int now) {
+  struct ptx *best = NULL;
+  for (int i=0; i<count; i++) {
+    struct ptx *ptx = &list[i];
+    if (ptx->asleep || !PT_TIME_DUE(now, ptx->next_due)) continue;
+    if (best == NULL || PT_TIME_BEFORE(ptx->next_due, best->next_due)) best = ptx;
+  }
+  return best;
+}
+
+// next deadline of a thread that was run at time now. A thread more
+// than a period late skips the runs it missed rather than making
+// them up back to back, and keeps its phase.
+static void pt_reschedule(struct ptx *ptx, unsigned int now) {
+  if (ptx->period == 0) {
+    ptx->next_due = now;
+    return;
+  }
+  ptx->next_due += ptx->period;
+  if (PT_TIME_DUE(now, ptx->next_due))
+    ptx->next_due += ((now - ptx->next_due) / ptx->period + 1) * ptx->period;
+}
+
 static PT_THREAD (protothread_sched(struct pt *pt))
 {   
     PT_BEGIN(pt);
     static int i, rate;
+    static struct ptx *due;
+    static unsigned int now;
     
     if (pt_sched_method==SCHED_ROUND_ROBIN){
         while(1) {
           // test stupid round-robin 
           // on all defined threads
           struct ptx *ptx = &pt_thread_list[0];
+          pt_wake_due(&pt_sleepers, timer_hw->timerawl);
           // step thru all defined threads
           // -- loop can have more than one initialization or increment/decrement, 
           // -- separated using comma operator. But it can have only one condition.
           for (i=0; i<pt_task_count; i++, ptx++ ){
-              // call thread function
-              (pt_thread_list[i].pf)(&ptx->pt); 
+              // call thread function, unless it sleeps
+              if (!ptx->asleep) pt_run(&pt_sleepers, ptx);
           }
           // Never yields! 
           // NEVER exit while!
         } // END WHILE(1)
     } //end if (pt_sched_method==RR)       
+    else if (pt_sched_method==SCHED_RATE){
+        while(1) {
+          // earliest deadline first, among the threads that are due
+          now = timer_hw->timerawl;
+          pt_wake_due(&pt_sleepers, now);
+          due = pt_earliest_due(pt_thread_list, pt_task_count, now);
+          if (due == NULL) continue;
+          pt_run(&pt_sleepers, due);
+          pt_reschedule(due, now);
+        } // END WHILE(1)
+    } //end if (pt_sched_method==SCHED_RATE)
      
     PT_END(pt);
 } // scheduler thread
@@ -785,23 +924,36 @@ static PT_THREAD (protothread_sched1(struct pt *pt))
     PT_BEGIN(pt);
     
     static int i, rate;
+    static struct ptx *due;
+    static unsigned int now;
     
     if (pt_sched_method==SCHED_ROUND_ROBIN){
         while(1) {
           // test stupid round-robin 
           // on all defined threads
           struct ptx *ptx = &pt_thread_list1[0];
+          pt_wake_due(&pt_sleepers1, timer_hw->timerawl);
           // step thru all defined threads
           // -- loop can have more than one initialization or increment/decrement, 
           // -- separated using comma operator. But it can have only one condition.
           for (i=0; i<pt_task_count1; i++, ptx++ ){
-              // call thread function
-              (pt_thread_list1[i].pf)(&ptx->pt); 
+              // call thread function, unless it sleeps
+              if (!ptx->asleep) pt_run(&pt_sleepers1, ptx);
           }
           // Never yields! 
           // NEVER exit while!
         } // END WHILE(1)
     } // end if(pt_sched_method==SCHED_ROUND_ROBIN)      
+    else if (pt_sched_method==SCHED_RATE){
+        while(1) {
+          now = timer_hw->timerawl;
+          pt_wake_due(&pt_sleepers1, now);
+          due = pt_earliest_due(pt_thread_list1, pt_task_count1, now);
+          if (due == NULL) continue;
+          pt_run(&pt_sleepers1, due);
+          pt_reschedule(due, now);
+        } // END WHILE(1)
+    } // end if(pt_sched_method==SCHED_RATE)
      
     PT_END(pt);
 } // scheduler1 thread
@@ -819,11 +971,14 @@ static PT_THREAD (protothread_sched1(struct pt *pt))
 } while(0) 
 
 // === package the add thread ==========================
-#define pt_add_thread(thread_name) do{\
+#define pt_add_thread(thread_name) pt_add_thread_rate(thread_name, 0)
+
+// a thread run every period usec under SCHED_RATE
+#define pt_add_thread_rate(thread_name, period) do{\
   if(get_core_num()==1){ \
-    pt_add1(thread_name);\
+    pt_add1(thread_name, period);\
   }  else {\
-    pt_add(thread_name);\
+    pt_add(thread_name, period);\
   }\
 } while(0) 
 
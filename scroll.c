@@ -0,0 +1,23 @@
+/**
+ * Tile motion for the piano tiles game
+ *
+ * The speed of step k is v0 + accel*min(k, ramp_steps), and the
+ * distance at step n is the sum of the speeds of the steps before it.
+ *
+ */
+#include "scroll.h"
+
+void scroll_init(scroll_t *s, uint64_t v0, uint64_t v_max, uint32_t ramp_steps) {
+    s->pos = 0 ;
+    s->v = s->v0 = v0 ;
+    s->step = 0 ;
+    s->ramp_steps = ramp_steps ;
+    s->accel = (ramp_steps && v_max > v0) ? (v_max - v0) / ramp_steps : 0 ;
+}
+
+uint64_t scroll_at(const scroll_t *s, uint32_t step) {
+    uint64_t n = step, r = s->ramp_steps ;
+    // sum of min(k, r) for k < n
+    uint64_t ramp = n <= r + 1 ? (n ? n * (n - 1) / 2 : 0) : r * (r + 1) / 2 + r * (n - r - 1) ;
+    return s->v0 * n + s->accel * ramp ;
+}
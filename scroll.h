@@ -0,0 +1,52 @@
+/**
+ * Tile motion for the piano tiles game
+ *
+ * The playfield scrolls down by a distance that grows every logic
+ * step. The speed starts at v0 and rises by the same amount each step
+ * until it reaches v_max: the difficulty ramp. Distances are 32.32
+ * fixed point pixels and speeds 32.32 pixels per step, so the motion
+ * accumulates sub-pixel steps and never drifts.
+ *
+ * Because the speed depends only on the step number, the distance at
+ * any future step has a closed form, scroll_at(). A tile stores where
+ * the scroll will be when it arrives at the hit line. Its screen y is
+ * then just that position minus the current scroll, with no per-frame
+ * multiply or divide.
+ *
+ * Integer only; hardware independent.
+ *
+ */
+#ifndef SCROLL_H
+#define SCROLL_H
+
+#include "pico/stdlib.h"
+
+// pixels per second at `hz` logic steps per second, as 32.32 px/step
+#define SCROLL_SPEED(px_per_s, hz) ((uint64_t)(px_per_s) * ((uint64_t)1 << 32) / (hz))
+
+typedef struct {
+    uint64_t pos ;          // distance scrolled, 32.32 px
+    uint64_t v ;            // speed of the current step, 32.32 px/step
+    uint64_t v0 ;
+    uint64_t accel ;        // speed added per step during the ramp
+    uint32_t step ;
+    uint32_t ramp_steps ;   // steps until the speed stops rising
+} scroll_t ;
+
+// Start at step 0 and speed v0, reaching v_max after ramp_steps steps
+void scroll_init(scroll_t *s, uint64_t v0, uint64_t v_max, uint32_t ramp_steps) ;
+// Advance one logic step
+static inline void scroll_step(scroll_t *s) {
+    s->pos += s->v ;
+    if (++s->step <= s->ramp_steps) s->v += s->accel ;
+}
+// Distance scrolled by the start of a given step, past or future
+uint64_t scroll_at(const scroll_t *s, uint32_t step) ;
+// 16.16 px position, wrapping; differences of up to 32767 px are exact
+static inline uint32_t scroll_pos16(uint64_t pos) { return (uint32_t)(pos >> 16) ; }
+// Speed in pixels per second at `hz` logic steps per second
+static inline uint scroll_px_per_s(const scroll_t *s, uint hz) {
+    return (uint)((s->v * hz) >> 32) ;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * Songs for the piano tiles game
+ *
+ * Built-in tracks and the streaming decoder (see song.h for the format)
+ *
+ */
+#include "song.h"
+
+// MIDI note numbers used by the built-in songs
+#define G2 43
+#define C3 48
+#define D3 50
+#define G3 55
+#define C4 60
+#define D4 62
+#define E4 64
+#define F4 65
+#define G4 67
+
+// Ode to Joy, one event per tile
+static const uint8_t ode_melody[] = {
+    E4,2,96,  E4,2,96,  F4,2,96,  G4,2,100, G4,2,100, F4,2,96,  E4,2,96,  D4,2,92,
+    C4,2,92,  C4,2,92,  D4,2,96,  E4,2,100, E4,3,104, D4,1,88,  D4,4,96,
+    E4,2,96,  E4,2,96,  F4,2,96,  G4,2,100, G4,2,100, F4,2,96,  E4,2,96,  D4,2,92,
+    C4,2,92,  C4,2,92,  D4,2,96,  E4,2,100, D4,3,100, C4,1,88,  C4,4,96,
+    D4,2,96,  D4,2,96,  E4,2,100, C4,2,92,  D4,2,96,  E4,1,100, F4,1,100, E4,2,96,
+    C4,2,92,  D4,2,96,  E4,1,100, F4,1,100, E4,2,96,  D4,2,92,  C4,2,92,  D4,2,96,
+    G3,4,88,
+    E4,2,96,  E4,2,96,  F4,2,96,  G4,2,100, G4,2,100, F4,2,96,  E4,2,96,  D4,2,92,
+    C4,2,92,  C4,2,92,  D4,2,96,  E4,2,100, D4,3,100, C4,1,88,  C4,4,96,
+    SONG_END,0,0
+} ;
+
+// Root and fifth on beats one and three, four bars per phrase
+static const uint8_t ode_accompaniment[] = {
+    C3,4,80, G3,4,64, G2,4,80, D3,4,64, C3,4,80, G3,4,64, G2,4,80, D3,4,64,
+    C3,4,80, G3,4,64, G2,4,80, D3,4,64, C3,4,80, G3,4,64, C3,8,72,
+    G2,4,80, D3,4,64, C3,4,80, G3,4,64, G2,4,80, D3,4,64, G2,8,72,
+    C3,4,80, G3,4,64, G2,4,80, D3,4,64, C3,4,80, G3,4,64, C3,8,72,
+    SONG_END,0,0
+} ;
+
+const song_t song_ode_to_joy = { ode_melody, ode_accompaniment } ;
+
+void song_cursor_init(song_cursor_t *cursor, const uint8_t *track) {
+    cursor->track = track ;
+    cursor->pos = 0 ;
+}
+
+void song_next(song_cursor_t *cursor, song_event_t *event) {
+    const uint8_t *p = cursor->track + cursor->pos ;
+    // loop back to the top at the end marker
+    if (p[0] == SONG_END) {
+        cursor->pos = 0 ;
+        p = cursor->track ;
+    }
+    event->note = p[0] ;
+    event->ticks = p[1] ;
+    event->velocity = p[2] ;
+    cursor->pos += SONG_EVENT_BYTES ;
+}
@@ -0,0 +1,53 @@
+/**
+ * Songs for the piano tiles game
+ *
+ * A track is a const byte array (so it stays in flash and is read
+ * through XIP) of 3-byte events:
+ *
+ *   byte 0 - MIDI note number, SONG_REST for a rest, SONG_END to loop
+ *   byte 1 - duration in song ticks (one tick is an eighth note)
+ *   byte 2 - velocity, 1..127
+ *
+ * The decoder only keeps a pointer and an offset per track, so a song
+ * of any length costs the same few bytes of SRAM.
+ *
+ */
+#ifndef SONG_H
+#define SONG_H
+
+#include "pico/stdlib.h"
+
+#define SONG_REST           0x00
+#define SONG_END            0xFF
+#define SONG_EVENT_BYTES    3
+
+// Tempo of the built-in songs
+#define SONG_BPM            120
+#define SONG_TICKS_PER_BEAT 2
+
+typedef struct {
+    uint8_t note ;
+    uint8_t ticks ;
+    uint8_t velocity ;
+} song_event_t ;
+
+// streaming read position in one track
+typedef struct {
+    const uint8_t *track ;
+    uint32_t pos ;
+} song_cursor_t ;
+
+// A melody (advanced by tile hits) and its accompaniment (plays in time)
+typedef struct {
+    const uint8_t *melody ;
+    const uint8_t *accompaniment ;
+} song_t ;
+
+extern const song_t song_ode_to_joy ;
+
+// Point a cursor at the start of a track
+void song_cursor_init(song_cursor_t *cursor, const uint8_t *track) ;
+// Decode the next event, wrapping around at SONG_END
+void song_next(song_cursor_t *cursor, song_event_t *event) ;
+
+#endif
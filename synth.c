@@ -0,0 +1,381 @@
+/**
+ * Sample generation for the piano tiles audio engine
+ *
+ * Everything here is pure computation: the sound effect state machine,
+ * the song sequencer and the wavetable note voices. It has no hardware
+ * dependencies, so the same file is built into the firmware (called
+ * from the 40 kHz ISR in audio.c) and into the host renderer in tools/.
+ *
+ */
+#include <string.h>
+#include "pico/stdlib.h"
+#include "math.h"
+#include "fix15.h"
+#include "synth.h"
+#include "song.h"
+#include "wavetables.h"
+#include "envelope.h"
+
+// Voice cost is measured with the SysTick counter of the audio core
+#ifdef SYNTH_HOST
+#define SYNTH_CYCLES() 0
+#else
+#include "hardware/structs/systick.h"
+#define SYNTH_CYCLES() (systick_hw->cvr)
+#endif
+#define SYSTICK_MASK        0x00FFFFFF
+
+volatile synth_stats_t synth_stats ;
+
+//Direct Digital Synthesis (DDS) parameters
+#define two32 4294967296.0  // 2^32 (a constant)
+
+// the DDS units
+// Phase accumulator and phase increment. Increment sets output frequency.
+volatile unsigned int phase_accum_main_0;
+volatile unsigned int phase_incr_main_0 = (400.0*two32)/Fs ;
+
+// DDS sine table (populated in synth_init())
+#define sine_table_size 256
+fix15 sin_table[sine_table_size] ;
+
+// Timing parameters for beeps (units of interrupts)
+#define ATTACK_TIME             200
+#define DECAY_TIME              200
+#define BEEP_DURATION           5200
+#define CHIRP_DURATION          2000
+#define SILENCE_DURATION        1200
+
+// Effect envelopes: attack and release of the old linear ramps, full
+// sustain in between. Release starts so that it ends with the effect.
+static const adsr_params_t beep_adsr = {
+    ADSR_TICKS(ATTACK_TIME), 0, int2fix15(1), ADSR_TICKS(DECAY_TIME) } ;
+
+typedef struct {
+    unsigned int duration ;         // samples, 0 for no such effect
+    const adsr_params_t *adsr ;     // NULL for a silent effect
+} effect_t ;
+
+static const effect_t effects[] = {
+    [SOUND_HIT]        = { BEEP_DURATION, &beep_adsr },
+    [SOUND_GAME_OVER]  = { BEEP_DURATION, &beep_adsr },
+    [SOUND_SILENCE]    = { SILENCE_DURATION, NULL },
+    [SOUND_SWEEP_DOWN] = { BEEP_DURATION, &beep_adsr },
+    [SOUND_SWEEP_LOW]  = { BEEP_DURATION, &beep_adsr },
+    [SOUND_CHIRP]      = { CHIRP_DURATION, &beep_adsr },
+} ;
+#define NUM_EFFECTS ((int)(sizeof(effects)/sizeof(effects[0])))
+
+static adsr_t effect_env ;
+
+// State machine variables
+volatile unsigned int STATE_0 = 0 ;
+volatile unsigned int count_0 = 0 ;
+
+// Pending sound request, picked up by the ISR when it is idle
+static volatile int flag = 0 ;
+
+// Mix levels (fraction of full scale at velocity 127)
+#define MELODY_LEVEL        float2fix15(0.6)
+#define ACCOMP_LEVEL        float2fix15(0.3)
+
+// Samples per song tick
+#define SONG_TICK_SAMPLES   ((Fs*60)/(SONG_BPM*SONG_TICKS_PER_BEAT))
+
+// Envelope per instrument (same order as wavetables.h)
+#define MS(ms) ADSR_TICKS((ms)*(Fs/1000))
+static const adsr_params_t instrument_adsr[NUM_INSTRUMENTS] = {
+    [INSTRUMENT_SINE]   = { MS(10), MS(100),  float2fix15(0.7),  MS(100) },
+    [INSTRUMENT_PIANO]  = { MS(2),  MS(900),  float2fix15(0.15), MS(150) },
+    [INSTRUMENT_SQUARE] = { MS(5),  MS(60),   float2fix15(0.8),  MS(60) },
+    [INSTRUMENT_SAW]    = { MS(5),  MS(250),  float2fix15(0.5),  MS(80) },
+    [INSTRUMENT_BELL]   = { MS(1),  MS(1500), 0,                 MS(400) },
+} ;
+
+typedef struct {
+    const int16_t *wave ;       // instrument wavetable (in flash)
+    const adsr_params_t *adsr ; // instrument envelope
+    unsigned int phase_accum ;
+    unsigned int phase_incr ;
+    adsr_t env ;
+    unsigned int count ;        // samples since note on
+    unsigned int gate ;         // samples until release
+    fix15 level ;               // voice mix level
+} voice_t ;
+
+static voice_t voices[NUM_VOICES] ;
+
+// DDS increments for MIDI notes 120..131; lower octaves shift right
+static unsigned int note_incr_top[12] ;
+
+// Song state (owned by the ISR)
+static const song_t *song = &song_ode_to_joy ;
+static song_cursor_t melody_cursor ;
+static song_cursor_t accomp_cursor ;
+static unsigned int accomp_wait ;
+static bool song_playing ;
+static uint32_t song_samples ;
+
+// Requests from the command side. Each side only writes its own
+// counter, so there is no read-modify-write race with the ISR.
+static volatile unsigned int melody_requests, melody_served ;
+static volatile uint32_t notes_started ;
+static volatile unsigned int song_starts, song_starts_served ;
+static volatile bool song_stop_request ;
+static volatile bool song_resume_request ;
+
+// Notes above the table's octave (MIDI stops at 127, a track byte does
+// not) play in the top octave instead of shifting by a negative count
+#define NOTE_TOP_OCTAVE 10
+static unsigned int note_phase_incr(uint8_t note) {
+    unsigned int octave = note / 12 ;
+    if (octave > NOTE_TOP_OCTAVE) octave = NOTE_TOP_OCTAVE ;
+    return note_incr_top[note % 12] >> (NOTE_TOP_OCTAVE - octave) ;
+}
+
+static void voice_note_on(voice_t *v, const song_event_t *event) {
+    if (event->note == SONG_REST) return ;
+    v->phase_incr = note_phase_incr(event->note) ;
+    v->count = 0 ;
+    v->gate = event->ticks * SONG_TICK_SAMPLES ;
+    adsr_note_on(&v->env, v->adsr, multfix15(v->level, event->velocity << 8)) ;
+}
+
+// Linear interpolation between neighbouring wavetable samples, using
+// the 16 phase bits below the table index. The guard sample at the end
+// of each table means index+1 never needs wrapping. Cost is fixed at
+// two loads and two multiplies per active voice, plus the envelope's
+// control-rate update every ADSR_CONTROL_PERIOD samples.
+static int voice_sample(voice_t *v) {
+    if (v->env.stage == ADSR_IDLE) return 0 ;
+
+    v->phase_accum += v->phase_incr ;
+    unsigned int index = v->phase_accum >> 24 ;
+    int frac = (v->phase_accum >> 8) & 0xffff ;
+    int s0 = v->wave[index] ;
+    int s1 = v->wave[index+1] ;
+    int sample = s0 + (((s1 - s0) * frac) >> 16) ;
+    int out = (sample * adsr_next(&v->env)) >> 15 ;
+
+    // >= so that a 0 tick event releases at once instead of holding
+    // forever; note off does nothing once the release has started
+    if (++v->count >= v->gate) adsr_note_off(&v->env) ;
+    return out ;
+}
+
+// Sequencer: runs once per sample ahead of the voices
+static void sequence(void) {
+    song_event_t event ;
+
+    if (song_starts != song_starts_served) {
+        song_starts_served = song_starts ;
+        song_cursor_init(&melody_cursor, song->melody) ;
+        song_cursor_init(&accomp_cursor, song->accompaniment) ;
+        accomp_wait = 0 ;
+        melody_served = melody_requests ;
+        song_samples = 0 ;
+        song_playing = true ;
+    }
+    if (song_stop_request) {
+        song_stop_request = false ;
+        song_playing = false ;
+        adsr_note_off(&voices[VOICE_ACCOMP].env) ;
+    }
+    if (song_resume_request) {
+        song_resume_request = false ;
+        // only a song that was started has a place to resume from
+        if (song_starts_served) song_playing = true ;
+    }
+    if (!song_playing) return ;
+    song_samples++ ;
+
+    // one melody note per tile hit
+    if (melody_served != melody_requests) {
+        melody_served += 1 ;
+        song_next(&melody_cursor, &event) ;
+        voice_note_on(&voices[VOICE_MELODY], &event) ;
+        notes_started++ ;
+    }
+
+    // the accompaniment keeps time on its own
+    if (accomp_wait == 0) {
+        song_next(&accomp_cursor, &event) ;
+        voice_note_on(&voices[VOICE_ACCOMP], &event) ;
+        accomp_wait = event.ticks * SONG_TICK_SAMPLES ;
+    }
+    // a 0 tick event moves on next sample rather than wrapping the wait
+    if (accomp_wait) accomp_wait -= 1 ;
+}
+
+//**********************************
+//***********************************************************sound
+
+// Sound effect state machine. Returns a signed sample, 0 when idle.
+// Each effect is a frequency curve over count_0 under an ADSR envelope.
+static int effect_sample(void) {
+    float y ;
+
+    if (STATE_0 == 0) {
+        // State transition?
+        count_0 += 1 ;
+        if (flag > 0 && flag < NUM_EFFECTS && effects[flag].duration) {
+            STATE_0 = flag ;
+            count_0 = 0 ;
+            if (effects[STATE_0].adsr) {
+                effect_env.out = 0 ;
+                adsr_note_on(&effect_env, effects[STATE_0].adsr, int2fix15(1)) ;
+            }
+        }
+        flag=0;
+        return 0 ;
+    }
+
+    const effect_t *effect = &effects[STATE_0] ;
+    int out = 0 ;
+
+    if (effect->adsr) {
+        if (STATE_0 == SOUND_HIT) {
+            y=-260*sin(-1*3.141592*count_0/5200)+1740;
+        }
+        else if (STATE_0 == SOUND_GAME_OVER) {
+            y=0.000184*count_0*count_0 + 2000; 
+        }
+        else if (STATE_0 == SOUND_SWEEP_DOWN) {
+            y=-0.5769*count_0+6000; 
+        }
+        else if (STATE_0 == SOUND_SWEEP_LOW) {
+            y=-0.192*count_0 + 3000; 
+        }
+        else {
+            y=-0.00099853142804*(count_0)*(count_0)+1.99456285608*count_0+1010; 
+        }
+
+        // DDS phase and sine table lookup
+        unsigned int phase_incr = y*two32/Fs ;
+        phase_accum_main_0 += phase_incr ;
+        out = fix2int15(multfix15(adsr_next(&effect_env),
+            sin_table[phase_accum_main_0>>24])) ;
+
+        // release so that the envelope closes as the effect ends
+        if (count_0 == effect->duration - (effect->adsr->release << ADSR_CONTROL_SHIFT)) {
+            adsr_note_off(&effect_env) ;
+        }
+    }
+
+    // Increment the counter
+    count_0 += 1 ;
+
+    // State transition?
+    if (count_0 == effect->duration) {
+        STATE_0 = 0 ;
+        count_0 = 0 ;
+    }
+    return out ;
+}
+
+int synth_sample() {
+    sequence() ;
+    int mix = effect_sample() ;
+
+    uint32_t start = SYNTH_CYCLES() ;
+    for (int i = 0; i < NUM_VOICES; i++) {
+        if (voices[i].env.stage != ADSR_IDLE) synth_stats.voice_samples++ ;
+        mix += voice_sample(&voices[i]) ;
+    }
+    synth_stats.voice_cycles += (start - SYNTH_CYCLES()) & SYSTICK_MASK ;
+
+    // clip to the 12-bit DAC range
+    mix += 2048 ;
+    if (mix < 0) mix = 0 ;
+    else if (mix > 4095) mix = 4095 ;
+    return mix ;
+}
+
+uint32_t synth_notes_started() {
+    return notes_started ;
+}
+
+uint32_t synth_song_samples() {
+    return song_samples ;
+}
+
+bool synth_song_playing() {
+    return song_playing ;
+}
+
+bool synth_busy() {
+    return STATE_0 != 0 || flag != 0 || song_playing
+        || voices[VOICE_MELODY].env.stage != ADSR_IDLE
+        || voices[VOICE_ACCOMP].env.stage != ADSR_IDLE ;
+}
+
+void synth_init() {
+    // start from silence (the host renderer re-inits between sounds)
+    STATE_0 = 0 ;
+    count_0 = 0 ;
+    flag = 0 ;
+    phase_accum_main_0 = 0 ;
+    memset(&effect_env, 0, sizeof(effect_env)) ;
+    memset((void *)voices, 0, sizeof(voices)) ;
+    song_playing = false ;
+    song_stop_request = false ;
+    song_resume_request = false ;
+    song_samples = 0 ;
+    melody_requests = melody_served = 0 ;
+    notes_started = 0 ;
+    song_starts = song_starts_served = 0 ;
+
+    // exponential curve for the ADSR envelopes
+    adsr_init_tables() ;
+
+    // Build the sine lookup table
+    // scaled to produce values between 0 and 4096 (for 12-bit DAC)
+    int ii;
+    for (ii = 0; ii < sine_table_size; ii++){
+         sin_table[ii] = float2fix15(2047*sin((float)ii*6.283/(float)sine_table_size));
+    }
+
+    // DDS increments for the top octave of MIDI notes (120..131)
+    for (ii = 0; ii < 12; ii++){
+        float freq = 440.0*pow(2.0, (120 + ii - 69)/12.0) ;
+        note_incr_top[ii] = (unsigned int)((freq*two32)/Fs) ;
+    }
+    voices[VOICE_MELODY].level = MELODY_LEVEL ;
+    voices[VOICE_MELODY].wave = wavetables[INSTRUMENT_PIANO] ;
+    voices[VOICE_MELODY].adsr = &instrument_adsr[INSTRUMENT_PIANO] ;
+    voices[VOICE_ACCOMP].level = ACCOMP_LEVEL ;
+    voices[VOICE_ACCOMP].wave = wavetables[INSTRUMENT_SQUARE] ;
+    voices[VOICE_ACCOMP].adsr = &instrument_adsr[INSTRUMENT_SQUARE] ;
+}
+
+void synth_command(uint32_t word) {
+    if (!IS_AUDIO_CMD(word)) return ;
+
+    uint sound = AUDIO_CMD_SOUND(word) ;
+    if (sound == SOUND_INSTRUMENT) {
+        uint voice = AUDIO_CMD_ARG0(word) ;
+        uint instrument = AUDIO_CMD_ARG1(word) ;
+        // pointer stores are atomic; a note already sounding keeps
+        // its envelope parameters until the next note on
+        if (voice < NUM_VOICES && instrument < NUM_INSTRUMENTS) {
+            voices[voice].wave = wavetables[instrument] ;
+            voices[voice].adsr = &instrument_adsr[instrument] ;
+        }
+    }
+    else if (sound == SOUND_MELODY_NOTE) {
+        melody_requests += 1 ;
+    }
+    else if (sound == SOUND_SONG_START) {
+        song_starts += 1 ;
+    }
+    else if (sound == SOUND_SONG_STOP) {
+        song_stop_request = true ;
+    }
+    else if (sound == SOUND_SONG_RESUME) {
+        song_resume_request = true ;
+    }
+    else {
+        flag = sound ;
+    }
+}
+
@@ -0,0 +1,76 @@
+/**
+ * Sample generation for the piano tiles audio engine
+ *
+ * Hardware independent: synth_sample() returns the next 12-bit DAC
+ * value and is called once per sample, by the audio ISR on the RP2040
+ * or by the host renderer in tools/. Sound commands use the same tagged
+ * 32-bit words that travel over the inter-core FIFO.
+ *
+ */
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "pico/stdlib.h"
+
+// Sample rate (the audio ISR fires once per sample)
+#define Fs 40000
+
+// Sound codes (same numbering as the old 'flag' variable)
+#define SOUND_NONE          0
+#define SOUND_HIT           1
+#define SOUND_GAME_OVER     2
+#define SOUND_SILENCE       4
+#define SOUND_SWEEP_DOWN    5
+#define SOUND_SWEEP_LOW     6
+#define SOUND_CHIRP         7
+// Song control (see song.h)
+#define SOUND_MELODY_NOTE   8   // play the next melody note
+#define SOUND_SONG_START    9   // rewind and start the accompaniment
+#define SOUND_SONG_STOP     10  // let the accompaniment ring out
+#define SOUND_INSTRUMENT    11  // args: voice, instrument (wavetables.h)
+#define SOUND_SONG_RESUME   12  // carry on from where the song stopped
+
+// Note voices
+#define VOICE_MELODY        0
+#define VOICE_ACCOMP        1
+#define NUM_VOICES          2
+
+// Sound commands are tagged in the top byte so that other users of
+// the inter-core FIFO can share it with the audio engine
+#define AUDIO_CMD_TAG       0xA5000000u
+#define AUDIO_CMD_MASK      0xFF000000u
+#define AUDIO_CMD(sound)    (AUDIO_CMD_TAG | (sound))
+#define IS_AUDIO_CMD(word)  (((word) & AUDIO_CMD_MASK) == AUDIO_CMD_TAG)
+// commands with two byte arguments: tag | arg1 | arg0 | sound
+#define AUDIO_CMD_ARGS(sound, arg0, arg1) \
+    (AUDIO_CMD_TAG | ((arg1) << 16) | ((arg0) << 8) | (sound))
+#define AUDIO_CMD_SOUND(word)   ((word) & 0xff)
+#define AUDIO_CMD_ARG0(word)    (((word) >> 8) & 0xff)
+#define AUDIO_CMD_ARG1(word)    (((word) >> 16) & 0xff)
+
+// Voice render counters (cycles are SysTick cycles, 0 on the host)
+typedef struct {
+    uint64_t voice_cycles ; // cycles spent rendering note voices
+    uint32_t voice_samples ;// active voice samples rendered
+} synth_stats_t ;
+
+extern volatile synth_stats_t synth_stats ;
+
+// Build the sine table and note increments, set up the voices
+void synth_init(void) ;
+// Next output sample, 0..4095 for the 12-bit DAC
+int synth_sample(void) ;
+// Apply one tagged command word (see AUDIO_CMD)
+void synth_command(uint32_t word) ;
+// True while an effect, a note or the song is still sounding
+bool synth_busy(void) ;
+// Melody notes started so far; a note's first sample is the one
+// returned by the synth_sample() call that started it
+uint32_t synth_notes_started(void) ;
+// Samples of the song played since it was started, not counting the
+// time it was stopped; the sample that starts the song counts as the first
+uint32_t synth_song_samples(void) ;
+// True while the song plays
+bool synth_song_playing(void) ;
+
+#endif
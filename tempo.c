@@ -0,0 +1,69 @@
+/**
+ * Master musical clock of the piano tiles game
+ *
+ */
+#include <stdio.h>
+#include "tempo.h"
+#include "audio.h"
+
+void tempo_start(tempo_t *t, uint64_t start_us, uint bpm, uint ticks_per_beat) {
+    t->start_us = t->now_us = start_us ;
+    t->offset_us = 0 ;
+    t->paused_us = 0 ;
+    t->song_start_us = 0 ;
+    t->bpm = bpm ;
+    t->ticks_per_beat = ticks_per_beat ;
+    t->started = false ;
+    t->free_running = false ;
+    t->drift_us = t->drift_min_us = t->drift_max_us = 0 ;
+}
+
+uint64_t tempo_update(tempo_t *t, uint32_t song_clock, uint64_t wall_us) {
+    // timer time into the game, pauses left out
+    uint64_t timer_us = wall_us - t->start_us - t->paused_us ;
+    uint64_t music_us = (uint64_t)AUDIO_SONG_SAMPLES(song_clock) * AUDIO_PERIOD_US ;
+
+    // The previous song was stopped before this one was requested, so
+    // the first time it plays is this song. Its first sample went out
+    // music_us ago.
+    if (!t->started && !t->free_running) {
+        if (song_clock & AUDIO_SONG_PLAYING) {
+            t->started = true ;
+            t->song_start_us = timer_us > music_us ? timer_us - music_us : 0 ;
+        }
+        else if (timer_us >= TEMPO_START_TIMEOUT_US) {
+            t->free_running = true ;
+            printf("tempo: the song did not start, following the timer\n") ;
+        }
+    }
+
+    if (t->started) {
+        t->drift_us = (int32_t)(music_us - (timer_us - t->song_start_us)) ;
+        if (t->drift_us < t->drift_min_us) t->drift_min_us = t->drift_us ;
+        if (t->drift_us > t->drift_max_us) t->drift_max_us = t->drift_us ;
+    }
+    else if (t->free_running) music_us = timer_us ;
+    else music_us = 0 ;
+
+    t->now_us = t->start_us + music_us ;
+    t->offset_us = (int64_t)(t->now_us - wall_us) ;
+    return t->now_us ;
+}
+
+void tempo_resume(tempo_t *t, uint64_t paused_us) {
+    t->paused_us += paused_us ;
+}
+
+uint32_t tempo_ticks(const tempo_t *t) {
+    return (t->now_us - t->start_us) * t->bpm * t->ticks_per_beat / 60000000 ;
+}
+
+void tempo_print(const tempo_t *t) {
+    if (!t->started) {
+        printf("TEMPO song not started\n") ;
+        return ;
+    }
+    printf("TEMPO song start %lu us, drift %ld us (min %ld, max %ld)\n",
+           (unsigned long)t->song_start_us, (long)t->drift_us,
+           (long)t->drift_min_us, (long)t->drift_max_us) ;
+}
@@ -0,0 +1,69 @@
+/**
+ * Master musical clock of the piano tiles game
+ *
+ * Game time follows the song, not the timer. Music time is the number
+ * of song samples the audio ISR has sent to the DAC (audio_song_clock)
+ * times the sample period. Logic steps run when music time reaches
+ * them, so a tile reaches the hit line on the sample its beat is
+ * played, however long the frames take, and stopping the song stops
+ * the game.
+ *
+ * Music time is kept in microseconds from the wall time the game
+ * started, like the step times of game.h. Input timestamps (wall time)
+ * are moved into it with tempo_from_wall(), and a step's wall time for
+ * waiting on comes from tempo_to_wall(); both use the offset of the
+ * last update. Music time reads one sample (25 us) coarse.
+ *
+ * Until the song's first sample the clock holds at the start. A song
+ * that has not started within TEMPO_START_TIMEOUT_US (its command was
+ * dropped) never will, and the clock runs on the timer instead.
+ *
+ * Drift is the music clock minus the timer, from the song's first
+ * sample and leaving out pauses: how far the sound has moved against
+ * the clock the frames are timed by. Samples the ISR skips, and the
+ * time the pause and resume commands take to reach the audio core,
+ * show up there.
+ *
+ */
+#ifndef TEMPO_H
+#define TEMPO_H
+
+#include "pico/stdlib.h"
+
+#define TEMPO_START_TIMEOUT_US  100000
+
+typedef struct {
+    uint64_t start_us ;         // wall time of music time 0
+    uint64_t now_us ;           // music time at the last update
+    int64_t offset_us ;         // music time minus wall time, at the last update
+    uint64_t paused_us ;        // wall time the game spent paused
+    uint64_t song_start_us ;    // timer time into the game of the song's first sample
+    uint bpm ;
+    uint ticks_per_beat ;
+    bool started ;              // the song has started
+    bool free_running ;         // it never did: the clock follows the timer
+    int32_t drift_us ;
+    int32_t drift_min_us ;
+    int32_t drift_max_us ;
+} tempo_t ;
+
+// Music time 0 is wall time start_us; the song, at bpm with
+// ticks_per_beat ticks a beat, is requested at the same time
+void tempo_start(tempo_t *t, uint64_t start_us, uint bpm, uint ticks_per_beat) ;
+// Read the audio ISR's song clock at wall time wall_us; returns music time
+uint64_t tempo_update(tempo_t *t, uint32_t song_clock, uint64_t wall_us) ;
+// The game was paused for paused_us of wall time, the song with it
+void tempo_resume(tempo_t *t, uint64_t paused_us) ;
+// Wall time to music time and back, as of the last update
+static inline uint64_t tempo_from_wall(const tempo_t *t, uint64_t wall_us) {
+    return wall_us + t->offset_us ;
+}
+static inline uint64_t tempo_to_wall(const tempo_t *t, uint64_t music_us) {
+    return music_us - t->offset_us ;
+}
+// Ticks of the song since music time 0, as of the last update
+uint32_t tempo_ticks(const tempo_t *t) ;
+// Song start and drift over the game, as a TEMPO line
+void tempo_print(const tempo_t *t) ;
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * Offline renderer for the piano tiles audio engine
+ *
+ * Runs synth.c exactly as the 40 kHz ISR does, but writes the samples
+ * to WAV files instead of the SPI DAC, so the sounds can be heard and
+ * compared without hardware.
+ *
+ *   audio_render [outdir]     write one <sound>.wav per sound
+ *   audio_render --bench      samples/second for each sound
+ *   audio_render --check      compare every sound with its golden CRC
+ *
+ * Every mode prints a CRC32 of each sound's samples. A refactor of the
+ * synthesis math that changes any sample changes the CRC, and --check
+ * (the audio_golden test) fails naming the sound. When a sound changes
+ * on purpose, its golden CRC in cases[] changes in the same commit.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "synth.h"
+#include "wavetables.h"
+
+// Commands issued at a given sample while rendering a sound
+typedef struct {
+    uint32_t at ;
+    uint32_t word ;
+} render_event_t ;
+
+typedef struct {
+    const char *name ;
+    uint32_t samples ;
+    const render_event_t *events ;
+    int num_events ;
+    int instrument ;            // melody instrument, -1 for the default
+    uint32_t note_interval ;    // > 0: a melody note every this many samples
+    uint32_t crc ;              // golden CRC32 of the samples
+} render_case_t ;
+
+static const render_event_t ev_hit[] = { {0, AUDIO_CMD(SOUND_HIT)} } ;
+static const render_event_t ev_game_over[] = { {0, AUDIO_CMD(SOUND_GAME_OVER)} } ;
+static const render_event_t ev_sweep_down[] = { {0, AUDIO_CMD(SOUND_SWEEP_DOWN)} } ;
+static const render_event_t ev_sweep_low[] = { {0, AUDIO_CMD(SOUND_SWEEP_LOW)} } ;
+static const render_event_t ev_chirp[] = { {0, AUDIO_CMD(SOUND_CHIRP)} } ;
+static const render_event_t ev_song[] = {
+    {0, AUDIO_CMD(SOUND_SONG_START)},
+    {6*Fs, AUDIO_CMD(SOUND_SONG_STOP)},
+} ;
+
+#define CASE(name, samples, ev) name, samples, ev, sizeof(ev)/sizeof(ev[0])
+
+static const render_case_t cases[] = {
+    { CASE("hit",        Fs/4, ev_hit),        -1, 0,                  0x98646cbb },
+    { CASE("game_over",  Fs/4, ev_game_over),  -1, 0,                  0x8de9533b },
+    { CASE("sweep_down", Fs/4, ev_sweep_down), -1, 0,                  0xdce7e6c9 },
+    { CASE("sweep_low",  Fs/4, ev_sweep_low),  -1, 0,                  0x52974e46 },
+    { CASE("chirp",      Fs/10, ev_chirp),     -1, 0,                  0x22ff25ea },
+    { CASE("song",       7*Fs, ev_song),       -1, Fs/4,               0xb842fcba },
+    { CASE("song_sine",  7*Fs, ev_song),       INSTRUMENT_SINE, Fs/4,  0x415e66ab },
+    { CASE("song_saw",   7*Fs, ev_song),       INSTRUMENT_SAW, Fs/4,   0x50b879d2 },
+    { CASE("song_bell",  7*Fs, ev_song),       INSTRUMENT_BELL, Fs/4,  0x539bcbb5 },
+} ;
+#define NUM_CASES (sizeof(cases)/sizeof(cases[0]))
+
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data ;
+    crc = ~crc ;
+    while (len--) {
+        crc ^= *p++ ;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1)) ;
+    }
+    return ~crc ;
+}
+
+// Render one case into out[] (12-bit DAC codes)
+static void render(const render_case_t *c, uint16_t *out) {
+    int next = 0 ;
+    synth_init() ;
+    if (c->instrument >= 0) {
+        synth_command(AUDIO_CMD_ARGS(SOUND_INSTRUMENT, VOICE_MELODY, c->instrument)) ;
+    }
+    for (uint32_t n = 0; n < c->samples; n++) {
+        while (next < c->num_events && c->events[next].at == n) {
+            synth_command(c->events[next++].word) ;
+        }
+        // tile hits, after the song has started
+        if (c->note_interval && n > 0 && n % c->note_interval == 0) {
+            synth_command(AUDIO_CMD(SOUND_MELODY_NOTE)) ;
+        }
+        out[n] = (uint16_t)synth_sample() ;
+    }
+}
+
+static void put16(FILE *f, uint16_t v) { fputc(v & 0xff, f) ; fputc(v >> 8, f) ; }
+static void put32(FILE *f, uint32_t v) { put16(f, v & 0xffff) ; put16(f, v >> 16) ; }
+
+// 16-bit mono PCM at Fs; DAC codes are centred and scaled up by 16
+static int write_wav(const char *path, const uint16_t *samples, uint32_t count) {
+    FILE *f = fopen(path, "wb") ;
+    if (!f) return -1 ;
+    fwrite("RIFF", 1, 4, f) ; put32(f, 36 + count*2) ; fwrite("WAVE", 1, 4, f) ;
+    fwrite("fmt ", 1, 4, f) ; put32(f, 16) ; put16(f, 1) ; put16(f, 1) ;
+    put32(f, Fs) ; put32(f, Fs*2) ; put16(f, 2) ; put16(f, 16) ;
+    fwrite("data", 1, 4, f) ; put32(f, count*2) ;
+    for (uint32_t n = 0; n < count; n++) {
+        put16(f, (uint16_t)(int16_t)((samples[n] - 2048) * 16)) ;
+    }
+    return fclose(f) ;
+}
+
+static double seconds(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+int main(int argc, char **argv) {
+    int bench = argc > 1 && strcmp(argv[1], "--bench") == 0 ;
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0 ;
+    const char *outdir = (!bench && !check && argc > 1) ? argv[1] : "." ;
+    int rc = 0 ;
+
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        const render_case_t *c = &cases[i] ;
+        uint16_t *buf = malloc(c->samples * sizeof(uint16_t)) ;
+        if (!buf) return 1 ;
+
+        render(c, buf) ;
+        uint32_t crc = crc32_update(0, buf, c->samples * sizeof(uint16_t)) ;
+
+        if (check) {
+            if (crc != c->crc) {
+                printf("%-12s crc %08x, expected %08x: the sound changed\n", c->name, crc, c->crc) ;
+                rc = 1 ;
+            }
+            else printf("%-12s crc %08x ok\n", c->name, crc) ;
+        }
+        else if (bench) {
+            // repeat until the measurement is long enough to trust
+            int reps = 0 ;
+            double start = seconds(), elapsed ;
+            do {
+                render(c, buf) ;
+                reps++ ;
+                elapsed = seconds() - start ;
+            } while (elapsed < 0.25) ;
+            double rate = (double)c->samples * reps / elapsed ;
+            printf("%-12s %8u samples  %12.0f samples/s  %7.1f ns/sample  %6.0fx realtime  crc %08x\n",
+                c->name, c->samples, rate, 1e9 / rate, rate / Fs, crc) ;
+        }
+        else {
+            char path[512] ;
+            snprintf(path, sizeof(path), "%s/%s.wav", outdir, c->name) ;
+            if (write_wav(path, buf, c->samples) != 0) {
+                fprintf(stderr, "cannot write %s\n", path) ;
+                rc = 1 ;
+            }
+            else {
+                printf("%-12s %8u samples  crc %08x  -> %s\n", c->name, c->samples, crc, path) ;
+            }
+        }
+        free(buf) ;
+    }
+    return rc ;
+}
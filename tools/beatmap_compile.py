@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""
+Compile a chart into a beatmap for the game (format in beatmap.h).
+
+A text chart has one directive or note per line, '#' starts a comment:
+
+    bpm 120                 tempo
+    ticks_per_beat 2        tick grid of the deltas below
+    lanes 4                 lanes the chart is written for, 1..8
+    2 ..x.                  a note: ticks since the previous note, then
+    0 x..x 4                one character per lane ('x' pressed, '.' not),
+                            then an optional hold length in ticks
+    end 4                   rest after the last note (for looping)
+
+A MIDI file (.mid) is quantized to the tick grid instead: notes starting
+on the same tick become one chord, pitches are spread over the lanes
+from low to high, and notes at least --hold-min ticks long become holds.
+
+The chart is validated before anything is written: every note needs a
+lane inside the chart's lane count, a note cannot start in a lane while
+a hold is still down there, and --inflight checks that no lane ever has
+more tiles on screen than the game's per-lane ring holds.
+
+usage: beatmap_compile.py <chart.chart|song.mid> [-o out.c|out.bin]
+                          [--name NAME] [--ticks-per-beat N] [--lanes N]
+                          [--hold-min N] [--inflight TICKS]
+    -o          .c writes a C array beatmap_<name>, anything else the
+                raw bytes; without -o only the statistics are printed
+    --inflight  ticks a tile is on screen before it arrives; fail if a
+                lane would need more than --ring tiles (default 16)
+"""
+import argparse
+import os
+import struct
+import sys
+
+VERSION = 1
+MAX_LANES = 8
+
+
+class ChartError(Exception):
+    pass
+
+
+def parse_text(lines):
+    """(header dict, [(tick, lanes mask, hold)], end rest) of a text chart."""
+    header = {"bpm": 120, "ticks_per_beat": 2, "lanes": 4}
+    notes, tick, end = [], 0, 0
+    for number, line in enumerate(lines, 1):
+        words = line.split("#", 1)[0].split()
+        if not words:
+            continue
+        try:
+            if words[0] in header:
+                header[words[0]] = int(words[1])
+            elif words[0] == "end":
+                end = int(words[1])
+            else:
+                tick += int(words[0])
+                pattern = words[1]
+                if len(pattern) != header["lanes"] or set(pattern) - set("x."):
+                    raise ChartError("lane pattern must be %d of 'x' and '.'" % header["lanes"])
+                mask = sum(1 << i for i, c in enumerate(pattern) if c == "x")
+                hold = int(words[2]) if len(words) > 2 else 0
+                notes.append((tick, mask, hold))
+        except (IndexError, ValueError) as e:
+            raise ChartError("line %d: %s" % (number, e or "missing value"))
+        except ChartError as e:
+            raise ChartError("line %d: %s" % (number, e))
+    return header, notes, end
+
+
+def read_varlen(data, pos):
+    v = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        v = v << 7 | byte & 0x7F
+        if not byte & 0x80:
+            return v, pos
+
+
+def parse_midi(data, ticks_per_beat, lanes, hold_min):
+    """Quantize a standard MIDI file into the same shape as parse_text()."""
+    if data[:4] != b"MThd":
+        raise ChartError("not a MIDI file")
+    _, ntracks, division = struct.unpack(">HHH", data[8:14])
+    if division & 0x8000:
+        raise ChartError("SMPTE time division is not supported")
+    pos, bpm, spans = 14, None, []
+    for _ in range(ntracks):
+        if data[pos:pos + 4] != b"MTrk":
+            raise ChartError("bad track header at byte %d" % pos)
+        length = struct.unpack(">I", data[pos + 4:pos + 8])[0]
+        p, end, t, status, down = pos + 8, pos + 8 + length, 0, 0, {}
+        while p < end:
+            delta, p = read_varlen(data, p)
+            t += delta
+            if data[p] & 0x80:
+                status = data[p]
+                p += 1
+            kind = status & 0xF0
+            if status == 0xFF:
+                meta = data[p]
+                length2, p = read_varlen(data, p + 1)
+                if meta == 0x51 and bpm is None:
+                    bpm = round(60000000 / int.from_bytes(data[p:p + 3], "big"))
+                p += length2
+            elif status in (0xF0, 0xF7):
+                length2, p = read_varlen(data, p)
+                p += length2
+            elif kind in (0x80, 0x90):
+                key, velocity = data[p], data[p + 1]
+                p += 2
+                if kind == 0x90 and velocity:
+                    down[key] = t
+                elif key in down:
+                    spans.append((down.pop(key), t, key))
+            else:
+                p += 1 if kind in (0xC0, 0xD0) else 2
+        pos = end
+    if not spans:
+        raise ChartError("no notes in MIDI file")
+
+    def quantize(t):
+        return (t * ticks_per_beat + division // 2) // division
+
+    pitches = sorted({key for _, _, key in spans})
+    lane_of = {key: i * lanes // len(pitches) for i, key in enumerate(pitches)}
+    chords = {}
+    for start, stop, key in spans:
+        tick = quantize(start)
+        length = quantize(stop) - tick
+        mask, hold = chords.get(tick, (0, 0))
+        chords[tick] = (mask | 1 << lane_of[key], max(hold, length if length >= hold_min else 0))
+    notes = [(tick, mask, hold) for tick, (mask, hold) in sorted(chords.items())]
+    last = max(quantize(stop) for _, stop, _ in spans)
+    header = {"bpm": bpm or 120, "ticks_per_beat": ticks_per_beat, "lanes": lanes}
+    return header, notes, max(0, last - notes[-1][0])
+
+
+def validate(header, notes, ring, inflight):
+    """Raise ChartError for a chart the game cannot play."""
+    lanes = header["lanes"]
+    if not 1 <= lanes <= MAX_LANES:
+        raise ChartError("lanes must be 1..%d" % MAX_LANES)
+    if not 1 <= header["ticks_per_beat"] <= 255:
+        raise ChartError("ticks_per_beat must be 1..255")
+    if not 1 <= header["bpm"] <= 0xFFFF:
+        raise ChartError("bpm must be 1..65535")
+    if not notes:
+        raise ChartError("chart has no notes")
+    held = [0] * lanes          # tick each lane's hold lets go
+    on_screen = [[] for _ in range(lanes)]
+    previous = 0
+    for n, (tick, mask, hold) in enumerate(notes):
+        where = "note %d (tick %d)" % (n + 1, tick)
+        if tick < previous:
+            raise ChartError("%s: notes out of order" % where)
+        if n and tick == previous:
+            raise ChartError("%s: two notes on one tick, write them as a chord" % where)
+        if mask == 0 or mask >> lanes:
+            raise ChartError("%s: lane mask %#x outside %d lanes" % (where, mask, lanes))
+        if not 0 <= hold <= 0xFFFF:
+            raise ChartError("%s: hold of %d ticks" % (where, hold))
+        for lane in range(lanes):
+            if not mask & 1 << lane:
+                continue
+            if tick < held[lane]:
+                raise ChartError("%s: lane %d is still held" % (where, lane + 1))
+            held[lane] = tick + hold
+            if inflight is not None:
+                # tiles spawned, not yet arrived, when this one spawns
+                alive = [t for t in on_screen[lane] if t > tick - inflight]
+                if len(alive) >= ring:
+                    raise ChartError("%s: more than %d tiles in flight in lane %d"
+                                     % (where, ring, lane + 1))
+                on_screen[lane] = alive + [tick]
+        previous = tick
+
+
+def varint(v):
+    out = bytearray()
+    while True:
+        byte = v & 0x7F
+        v >>= 7
+        out.append(byte | (0x80 if v else 0))
+        if not v:
+            return out
+
+
+def encode(header, notes, end):
+    out = bytearray(b"BM")
+    out += bytes([VERSION, header["lanes"], header["ticks_per_beat"], 0])
+    out += struct.pack("<H", header["bpm"])
+    previous = 0
+    for tick, mask, hold in notes:
+        out += varint((tick - previous) << 1 | (1 if hold else 0))
+        out.append(mask)
+        if hold:
+            out += varint(hold)
+        previous = tick
+    out += varint(end << 1)
+    out.append(0)
+    return bytes(out)
+
+
+def c_array(name, data, source):
+    lines = [
+        "// Generated by tools/beatmap_compile.py from %s -- do not edit" % source,
+        '#include "beatmap.h"',
+        "",
+        "const uint8_t beatmap_%s[%d] = {" % (name, len(data)),
+    ]
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    lines.append("} ;")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("chart")
+    ap.add_argument("-o", dest="out")
+    ap.add_argument("--name")
+    ap.add_argument("--ticks-per-beat", type=int, default=2)
+    ap.add_argument("--lanes", type=int, default=4)
+    ap.add_argument("--hold-min", type=int, default=4)
+    ap.add_argument("--inflight", type=int)
+    ap.add_argument("--ring", type=int, default=16)
+    args = ap.parse_args()
+
+    try:
+        if args.chart.lower().endswith((".mid", ".midi")):
+            with open(args.chart, "rb") as f:
+                chart = parse_midi(f.read(), args.ticks_per_beat, args.lanes, args.hold_min)
+        else:
+            with open(args.chart) as f:
+                chart = parse_text(f)
+        validate(chart[0], chart[1], args.ring, args.inflight)
+    except (ChartError, IndexError, struct.error) as e:
+        sys.exit("%s: %s" % (args.chart, e or "truncated file"))
+
+    header, notes, end = chart
+    data = encode(header, notes, end)
+    name = args.name or os.path.splitext(os.path.basename(args.chart))[0]
+    if args.out and args.out.endswith(".c"):
+        with open(args.out, "w") as f:
+            f.write(c_array(name, data, os.path.basename(args.chart)))
+    elif args.out:
+        with open(args.out, "wb") as f:
+            f.write(data)
+    holds = sum(1 for _, _, hold in notes if hold)
+    print("%s: %d notes (%d holds), %d ticks, %d lanes, %d bpm, %d bytes, %.2f bytes/note"
+          % (name, len(notes), holds, notes[-1][0] + end, header["lanes"], header["bpm"],
+             len(data), len(data) / len(notes)), file=sys.stderr if args.out else sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
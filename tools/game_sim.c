@@ -0,0 +1,214 @@
+/**
+ * Headless runs of the piano tiles game logic
+ *
+ * Steps the same game core as the firmware (game.c) with a simulated
+ * clock and scripted presses, without the screen, sound or sensors.
+ *
+ *   game_sim --bench [seconds]        a perfect player for `seconds` of
+ *                                     game time; logic steps/second
+ *   game_sim --fuzz [games] [seed]    random presses, invariants checked
+ *                                     after every step
+ *
+ * The bench prints the final score and tile counts; a change to the
+ * game logic that changes how a game plays out changes them.
+ *
+ * The fuzzer presses lanes at random and near the tiles with a random
+ * error, so games see every grade, chords and misses. After each step
+ * it checks that the score never goes down, that every spawned tile is
+ * still in its lane or has arrived, that every arrived tile was graded
+ * or is waiting for its late window, and that the lanes stay in arrival
+ * order. The first failure prints the seed, game and step to rerun.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "game.h"
+
+#define SIM_START_US        1000000     // the device's clock is never 0
+#define FUZZ_MAX_STEPS      (180 * LOGIC_HZ)
+#define FUZZ_AIM_ERROR_US   150000      // aimed presses land within this
+#define FUZZ_STRAY_PERCENT  2           // chance of a random press per step
+
+static uint32_t rng = 1 ;
+
+static uint32_t random32(void) {
+    // xorshift32
+    rng ^= rng << 13 ;
+    rng ^= rng >> 17 ;
+    rng ^= rng << 5 ;
+    return rng ;
+}
+
+static double seconds(void) {
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+// Input lane that drives a playfield lane
+static uint input_for(const game_t *g, uint lane) {
+    for (uint in = 0; in < NUM_LANES; in++) {
+        if (g->pf.input_lanes[in] & (1u << lane)) return in ;
+    }
+    return 0 ;
+}
+
+// Press every lane whose oldest tile arrives in the coming step, exactly
+// on time
+static void perfect_player(game_t *g) {
+    for (uint lane = 0; lane < g->pf.count; lane++) {
+        if (!playfield_tiles(&g->pf, lane)) continue ;
+        uint32_t arrival = g->pf.tile_arrival[lane][playfield_slot(&g->pf, lane, 0)] ;
+        if (arrival == g->step) game_press(g, input_for(g, lane), game_step_us(g, arrival)) ;
+    }
+}
+
+// Run one game of at most max_steps with the perfect player
+static uint32_t bench_game(game_t *g, uint32_t max_steps) {
+    game_init(g, beatmap_ode_to_joy, 4, SIM_START_US) ;
+    while (g->step < max_steps && !g->over) {
+        perfect_player(g) ;
+        game_step(g, 0) ;
+    }
+    return g->step ;
+}
+
+static int bench(double game_seconds) {
+    game_t g ;
+    uint32_t max_steps = (uint32_t)(game_seconds * LOGIC_HZ) ;
+    uint64_t steps = 0 ;
+    int reps = 0 ;
+    double start = seconds(), elapsed ;
+    do {
+        steps += bench_game(&g, max_steps) ;
+        reps++ ;
+        elapsed = seconds() - start ;
+    } while (elapsed < 0.25) ;
+    double rate = steps / elapsed ;
+    printf("%d x %.0f s of game: %.0f steps/s, %.1f us/step, %.0fx realtime\n",
+           reps, game_seconds, rate, 1e6 / rate, rate / LOGIC_HZ) ;
+    printf("score %u, max combo %u, %u tiles spawned, %u arrived, %s\n",
+           (unsigned)g.judge.score, (unsigned)g.judge.max_combo,
+           (unsigned)g.tiles_spawned, (unsigned)g.tiles_arrived, g.over ? "missed" : "no miss") ;
+    return g.over ? 1 : 0 ;
+}
+
+// Aimed presses still to make: the lane and when
+#define AIMED_MAX 64
+typedef struct {
+    uint8_t input ;
+    uint64_t time_us ;
+} aimed_t ;
+
+static aimed_t aimed[AIMED_MAX] ;
+static uint num_aimed ;
+static uint8_t aimed_head[PLAYFIELD_MAX_LANES] ;   // tile_head when last aimed
+
+static void fuzz_start(void) {
+    num_aimed = 0 ;
+    memset(aimed_head, 0, sizeof(aimed_head)) ;
+}
+
+static void fuzz_inputs(game_t *g) {
+    uint64_t step_us = game_step_us(g, g->step) ;
+    // aim at each tile once, when it spawns; most presses land close to
+    // the arrival, some far enough off to miss
+    for (uint lane = 0; lane < g->pf.count; lane++) {
+        while (aimed_head[lane] != g->pf.tile_head[lane] && num_aimed < AIMED_MAX) {
+            uint slot = aimed_head[lane]++ & (LANE_TILES - 1) ;
+            int32_t error = ((int32_t)(random32() % (2*FUZZ_AIM_ERROR_US + 1)) - FUZZ_AIM_ERROR_US)
+                            * (int32_t)(random32() % 5) / 4 ;
+            aimed[num_aimed].input = input_for(g, lane) ;
+            aimed[num_aimed].time_us = game_step_us(g, g->pf.tile_arrival[lane][slot]) + error ;
+            num_aimed++ ;
+        }
+    }
+    // presses due before the next step, in any order the sensors allow
+    for (uint i = 0; i < num_aimed; ) {
+        if (aimed[i].time_us < step_us + LOGIC_STEP_US) {
+            uint64_t t = aimed[i].time_us < step_us ? step_us : aimed[i].time_us ;
+            game_press(g, aimed[i].input, t) ;
+            aimed[i] = aimed[--num_aimed] ;
+        }
+        else i++ ;
+    }
+    if (random32() % 100 < FUZZ_STRAY_PERCENT) {
+        game_press(g, random32() % NUM_LANES, step_us + random32() % LOGIC_STEP_US) ;
+    }
+}
+
+static const char *check(const game_t *g, uint32_t last_score) {
+    const playfield_t *pf = &g->pf ;
+    uint32_t in_flight = 0, graded = 0, pending = 0 ;
+    if (g->judge.score < last_score) return "score went down" ;
+    if (g->judge.combo > g->judge.max_combo) return "combo above max combo" ;
+    if (pf->tiles_dropped) return "tile dropped from a full lane" ;
+    for (uint lane = 0; lane < pf->count; lane++) {
+        uint n = playfield_tiles(pf, lane) ;
+        in_flight += n ;
+        for (uint i = 0; i < n; i++) {
+            uint32_t arrival = pf->tile_arrival[lane][playfield_slot(pf, lane, i)] ;
+            if (arrival < g->step) return "tile in a lane after its arrival" ;
+            if (i && arrival < pf->tile_arrival[lane][playfield_slot(pf, lane, i - 1)]) return "lane out of arrival order" ;
+        }
+    }
+    if (g->tiles_spawned != g->tiles_arrived + in_flight) return "tile lost" ;
+    for (uint lane = 0; lane < JUDGE_MAX_LANES; lane++) {
+        for (uint grade = 0; grade < NUM_GRADES; grade++) graded += g->judge.lane[lane].grades[grade] ;
+        pending += (uint8_t)(g->judge.pending_head[lane] - g->judge.pending_tail[lane]) ;
+    }
+    if (graded + pending != g->tiles_arrived) return "arrived tile neither graded nor pending" ;
+    if (g->over && !g->missed) return "game over without a miss" ;
+    return NULL ;
+}
+
+static int fuzz(uint games, uint32_t seed) {
+    game_t g ;
+    uint64_t steps = 0, grades[NUM_GRADES] = {0} ;
+    rng = seed ? seed : 1 ;
+    for (uint n = 0; n < games; n++) {
+        static const uint layouts[] = { 4, 6, 8 } ;
+        uint lanes = layouts[random32() % 3] ;
+        uint32_t last_score = 0 ;
+        game_init(&g, beatmap_ode_to_joy, lanes, SIM_START_US + random32() % 1000000) ;
+        fuzz_start() ;
+        while (!g.over && g.step < FUZZ_MAX_STEPS) {
+            fuzz_inputs(&g) ;
+            game_step(&g, random32() % 8000) ;
+            const char *failure = check(&g, last_score) ;
+            if (failure) {
+                printf("FAIL seed %u game %u (%u lanes) step %u: %s\n",
+                       (unsigned)seed, n, lanes, (unsigned)g.step, failure) ;
+                return 1 ;
+            }
+            last_score = g.judge.score ;
+        }
+        steps += g.step ;
+        for (uint lane = 0; lane < JUDGE_MAX_LANES; lane++) {
+            for (uint grade = 0; grade < NUM_GRADES; grade++) grades[grade] += g.judge.lane[lane].grades[grade] ;
+        }
+    }
+    printf("seed %u: %u games, %llu steps, all invariants held\n",
+           (unsigned)seed, games, (unsigned long long)steps) ;
+    printf("grades %s %llu, %s %llu, %s %llu, %s %llu\n",
+           judge_grade_name(JUDGE_PERFECT), (unsigned long long)grades[JUDGE_PERFECT],
+           judge_grade_name(JUDGE_GREAT), (unsigned long long)grades[JUDGE_GREAT],
+           judge_grade_name(JUDGE_GOOD), (unsigned long long)grades[JUDGE_GOOD],
+           judge_grade_name(JUDGE_MISS), (unsigned long long)grades[JUDGE_MISS]) ;
+    return 0 ;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return bench(argc > 2 ? atof(argv[2]) : 600) ;
+    }
+    if (argc > 1 && strcmp(argv[1], "--fuzz") == 0) {
+        return fuzz(argc > 2 ? atoi(argv[2]) : 1000,
+                    argc > 3 ? strtoul(argv[3], NULL, 0) : (uint32_t)time(NULL)) ;
+    }
+    fprintf(stderr, "usage: %s --bench [seconds] | --fuzz [games] [seed]\n", argv[0]) ;
+    return 2 ;
+}
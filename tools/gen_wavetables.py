@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""
+Generate the instrument wavetables for the audio engine.
+
+Writes a C file with one single-cycle table per instrument. Each table
+holds WAVETABLE_SIZE samples plus one guard sample (a copy of sample 0)
+so the interpolating lookup never has to wrap its index. Samples are
+int16 scaled to +/-2047, the swing of the 12-bit DAC around mid-scale.
+
+Square and saw are built from a limited number of harmonics so that the
+tables are band limited and do not alias at the notes the songs use.
+
+usage: gen_wavetables.py <output.c>
+"""
+import math
+import sys
+
+WAVETABLE_SIZE = 256
+PEAK = 2047
+
+# name -> list of (harmonic, amplitude)
+INSTRUMENTS = [
+    ("sine",   [(1, 1.0)]),
+    ("piano",  [(1, 1.0), (2, 0.55), (3, 0.30), (4, 0.18), (5, 0.10),
+                (6, 0.06), (7, 0.03), (8, 0.02)]),
+    ("square", [(h, 1.0 / h) for h in range(1, 24, 2)]),
+    ("saw",    [(h, 1.0 / h) for h in range(1, 17)]),
+    ("bell",   [(1, 1.0), (2, 0.6), (3, 0.25), (5, 0.45), (7, 0.2),
+                (9, 0.15), (11, 0.1)]),
+]
+
+
+def build(partials):
+    raw = [sum(a * math.sin(2 * math.pi * h * i / WAVETABLE_SIZE)
+               for h, a in partials)
+           for i in range(WAVETABLE_SIZE)]
+    scale = PEAK / max(abs(x) for x in raw)
+    table = [int(round(x * scale)) for x in raw]
+    return table + [table[0]]
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    lines = [
+        "// Generated by tools/gen_wavetables.py -- do not edit",
+        '#include "wavetables.h"',
+        "",
+    ]
+    for name, partials in INSTRUMENTS:
+        table = build(partials)
+        lines.append("static const int16_t wave_%s[WAVETABLE_SIZE + 1] = {" % name)
+        for i in range(0, len(table), 12):
+            lines.append("    " + ", ".join("%d" % v for v in table[i:i + 12]) + ",")
+        lines.append("} ;")
+        lines.append("")
+    lines.append("const int16_t * const wavetables[NUM_INSTRUMENTS] = {")
+    for name, _ in INSTRUMENTS:
+        lines.append("    wave_%s," % name)
+    lines.append("} ;")
+    with open(sys.argv[1], "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,12 @@
+// Minimal stand-in for the Pico SDK header so that the hardware
+// independent sources (synth.c, song.c) build on a PC
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint ;
+
+#endif
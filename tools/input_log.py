@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+Extract and decode lane input recordings.
+
+The game dumps a recording over USB stdio as "REC <hex>" lines ending
+with "REC END" (input_record.c). This pulls the stream out of a captured
+serial log and decodes it: each event is an LEB128 varint of
+    (us since the previous event) << 4 | edge << 3 | lane
+
+usage: input_log.py <log.txt> [-o stream.bin] [--c name]
+    -o      also write the raw stream, e.g. to replay it later
+    --c     print the stream as a C array, for input_replay_start(),
+            instead of the event list
+"""
+import argparse
+import sys
+
+
+def extract(lines):
+    """Bytes of the last complete recording in a log."""
+    current, last = None, None
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("REC"):
+            continue
+        if line.startswith("REC END"):
+            last, current = current or bytearray(), None
+        else:
+            if current is None:
+                current = bytearray()
+            current += bytes.fromhex(line[4:])
+    return bytes(last) if last is not None else None
+
+
+def decode(stream):
+    """(time_us, lane, edge) of every event."""
+    events, t, v, shift = [], 0, 0, 0
+    for byte in stream:
+        v |= (byte & 0x7F) << shift
+        shift += 7
+        if byte & 0x80:
+            continue
+        t += v >> 4
+        events.append((t, v & 7, (v >> 3) & 1))
+        v, shift = 0, 0
+    if shift:
+        sys.exit("stream ends inside an event")
+    return events
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("log")
+    ap.add_argument("-o", dest="out")
+    ap.add_argument("--c", dest="cname")
+    args = ap.parse_args()
+
+    with open(args.log, errors="replace") as f:
+        stream = extract(f)
+    if stream is None:
+        sys.exit("no complete recording (REC ... REC END) in " + args.log)
+    if args.out:
+        with open(args.out, "wb") as f:
+            f.write(stream)
+
+    if args.cname:
+        print("const uint8_t %s[%d] = {" % (args.cname, len(stream)))
+        for i in range(0, len(stream), 16):
+            print("    " + ", ".join("0x%02x" % b for b in stream[i:i + 16]) + ",")
+        print("} ;")
+        return
+
+    events = decode(stream)
+    presses = [0] * 8
+    for t, lane, edge in events:
+        print("%10.3f ms  lane %d  %s" % (t / 1000.0, lane + 1, "press" if edge else "release"))
+        presses[lane] += edge
+    print("%d events in %d bytes, presses per lane: %s"
+          % (len(events), len(stream),
+             " ".join("%d:%d" % (lane + 1, p) for lane, p in enumerate(presses) if p)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""
+Summarize the latency traces printed by the game (latency.c).
+
+Reads one or more captured USB serial logs, adds up the HIST lines of
+every game per span (framebuffer, photon, sound) and prints the
+percentiles and a text histogram of each.
+
+usage: latency_report.py <log.txt> [more logs...] [--width N]
+"""
+import argparse
+import sys
+
+
+def read_hists(paths):
+    """span -> (bin_us, bins, counts) summed over every HIST line."""
+    hists = {}
+    for path in paths:
+        with open(path, errors="replace") as f:
+            for line in f:
+                fields = line.split()
+                if len(fields) < 4 or fields[0] != "HIST":
+                    continue
+                span, bin_us, bins = fields[1], int(fields[2]), int(fields[3])
+                counts = [int(c) for c in fields[4:]]
+                if span not in hists:
+                    hists[span] = (bin_us, bins, [0] * (bins + 1))
+                elif hists[span][:2] != (bin_us, bins):
+                    sys.exit("%s: %s histogram changed shape" % (path, span))
+                total = hists[span][2]
+                for i, c in enumerate(counts):
+                    total[i] += c
+    return hists
+
+
+def percentile(counts, bin_us, fraction):
+    need, seen = sum(counts) * fraction, 0
+    for i, c in enumerate(counts):
+        seen += c
+        if seen >= need:
+            return (i + 1) * bin_us
+    return len(counts) * bin_us
+
+
+def report(span, bin_us, bins, counts, width):
+    n = sum(counts)
+    if n == 0:
+        return
+    print("%s: %d samples  p50 <%.1f ms  p90 <%.1f ms  p99 <%.1f ms%s" % (
+        span, n,
+        percentile(counts, bin_us, 0.5) / 1000.0,
+        percentile(counts, bin_us, 0.9) / 1000.0,
+        percentile(counts, bin_us, 0.99) / 1000.0,
+        "  (%d over %.0f ms)" % (counts[bins], bins * bin_us / 1000.0) if counts[bins] else ""))
+    last = max(i for i, c in enumerate(counts) if c)
+    first = min(i for i, c in enumerate(counts) if c)
+    peak = max(counts)
+    for i in range(first, last + 1):
+        label = ">%5.0f ms" % (bins * bin_us / 1000.0) if i == bins else "%6.0f ms" % (i * bin_us / 1000.0)
+        bar = "#" * max(1 if counts[i] else 0, counts[i] * width // peak)
+        print("  %s %6d %s" % (label, counts[i], bar))
+    print()
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("logs", nargs="+")
+    ap.add_argument("--width", type=int, default=50)
+    args = ap.parse_args()
+
+    hists = read_hists(args.logs)
+    if not hists:
+        sys.exit("no HIST lines found")
+    for span in ("framebuffer", "photon", "sound"):
+        if span in hists:
+            report(span, *hists.pop(span), args.width)
+    for span, h in sorted(hists.items()):
+        report(span, *h, args.width)
+
+
+if __name__ == "__main__":
+    main()
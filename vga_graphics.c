@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
 #include "hardware/dma.h"
@@ -147,6 +148,36 @@ void initVGA() {
 }
 
 
+// The line being sent to the screen, from where the pixel DMA (channel 0)
+// is in the frame buffer. Reads 0 during vertical blanking, when the DMA
+// waits at the start of the buffer.
+short vga_scanline() {
+    return (dma_hw->ch[0].read_addr - (uint32_t)(uintptr_t)vga_data_array) / (RGB_ACTIVE + 1) ;
+}
+
+
+// A rectangle of the frame buffer, two pixels per byte, is copied row by
+// row with memcpy, much faster than redrawing what was there.
+int vga_region_bytes(short x, short w, short h) {
+    return (((x + w + 1) >> 1) - (x >> 1)) * h ;
+}
+
+void vga_save_region(short x, short y, short w, short h, unsigned char *buf) {
+    int row = ((x + w + 1) >> 1) - (x >> 1) ;
+    for (short j = y; j < y + h; j++) {
+        memcpy(buf, &vga_data_array[(640 * j + x) >> 1], row) ;
+        buf += row ;
+    }
+}
+
+void vga_restore_region(short x, short y, short w, short h, const unsigned char *buf) {
+    int row = ((x + w + 1) >> 1) - (x >> 1) ;
+    for (short j = y; j < y + h; j++) {
+        memcpy(&vga_data_array[(640 * j + x) >> 1], buf, row) ;
+        buf += row ;
+    }
+}
+
 // A function for drawing a pixel with a specified color.
 // Note that because information is passed to the PIO state machines through
 // a DMA channel, we only need to modify the contents of the array and the
@@ -28,8 +28,13 @@ enum vga_pins {HSYNC=16, VSYNC, RED_PIN, GREEN_PIN, BLUE_PIN} ;
 // We can only produce 8 (3-bit) colors, so let's give them readable names - usable in main()
 enum colors {BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE} ;
 
+// Scanout timing (25 MHz pixel clock, 800 clocks x 525 lines)
+#define VGA_LINE_US     32
+#define VGA_FRAME_LINES 525
+
 // VGA primitives - usable in main
 void initVGA(void) ;
+short vga_scanline(void) ;
 void drawPixel(short x, short y, char color) ;
 void drawVLine(short x, short y, short h, char color) ;
 void drawHLine(short x, short y, short w, char color) ;
@@ -50,3 +55,10 @@ void setTextSize(unsigned char s);
 void setTextWrap(char w);
 void tft_write(unsigned char c) ;
 void writeString(char* str) ;
+
+// Copy a rectangle of the frame buffer out and back in (whole bytes, so
+// x and the width are widened to even pixels). buf holds
+// vga_region_bytes(x, w, h) bytes.
+int vga_region_bytes(short x, short w, short h) ;
+void vga_save_region(short x, short y, short w, short h, unsigned char *buf) ;
+void vga_restore_region(short x, short y, short w, short h, const unsigned char *buf) ;
@@ -0,0 +1,26 @@
+/**
+ * Instrument wavetables for the audio engine
+ *
+ * The tables themselves are generated at build time by
+ * tools/gen_wavetables.py and end up as const data in flash.
+ * Every table has WAVETABLE_SIZE samples plus a guard sample.
+ *
+ */
+#ifndef WAVETABLES_H
+#define WAVETABLES_H
+
+#include "pico/stdlib.h"
+
+#define WAVETABLE_SIZE  256
+
+// must match the order of INSTRUMENTS in tools/gen_wavetables.py
+#define INSTRUMENT_SINE     0
+#define INSTRUMENT_PIANO    1
+#define INSTRUMENT_SQUARE   2
+#define INSTRUMENT_SAW      3
+#define INSTRUMENT_BELL     4
+#define NUM_INSTRUMENTS     5
+
+extern const int16_t * const wavetables[NUM_INSTRUMENTS] ;
+
+#endif